@@ -2,4 +2,8 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     ActionSimulationEditor \
-    ActionSimulationServer
+    ActionSimulationServer \
+    ActionSimulationBase/tests
+
+# io_uring 版本同时编译 epoll 版本作为后备
+linux:io_uring: SUBDIRS += ActionSimulationServer/epoll
@@ -1,5 +1,11 @@
 INCLUDEPATH += D:/Labraries/boost_1_80_0  \
 
+# qmake CONFIG+=io_uring: Linux 下使用 io_uring 代替 epoll (需要 liburing 和 5.10 以上内核)
+linux:io_uring {
+    DEFINES += BOOST_ASIO_HAS_IO_URING BOOST_ASIO_DISABLE_EPOLL
+    LIBS += -luring
+}
+
 HEADERS += \
     $$PWD/commonconst.h \
     $$PWD/errorcode.h \
@@ -12,6 +18,13 @@ HEADERS += \
     $$PWD/tcpserver.h \
     $$PWD/datapackage.h \
     $$PWD/iocontextpool.h \
+    $$PWD/jsonscanner.h \
+    $$PWD/flatjsonparser.h \
+    $$PWD/messagecodec.h \
+    $$PWD/handlerallocator.h \
+    $$PWD/timerwheel.h \
+    $$PWD/tokenbucket.h \
+    $$PWD/writerpreferringmutex.h \
     $$PWD/commonstruct.h
 
 SOURCES += \
@@ -22,4 +35,8 @@ SOURCES += \
     $$PWD/tcpconnection.cpp \
     $$PWD/tcpserver.cpp \
     $$PWD/datapackage.cpp \
+    $$PWD/jsonscanner.cpp \
+    $$PWD/flatjsonparser.cpp \
+    $$PWD/messagecodec.cpp \
+    $$PWD/timerwheel.cpp \
     $$PWD/iocontextpool.cpp
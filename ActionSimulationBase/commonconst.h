@@ -132,7 +132,12 @@ const char* const ProjectSuffix = ".json";
 
 const int32_t JsonBagMaxLength = 1024 * 1024 * 100;
 
+//连接的第一个字节为 LengthPrefixMagic 时,双向数据包均以 4 字节大端长度开头
+const uint8_t LengthPrefixMagic = 0x02;
+const size_t LengthPrefixSize = 4;
+
 const char* const Boardcast = "_boardcast";
+const char* const BatchEvent = "_batch";
 const char* const TimerEvent = "_Timer";
 const char* const LoopEvent = "_Loop";
 const char* const OrderEvent = "_Order";
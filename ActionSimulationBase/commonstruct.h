@@ -26,8 +26,10 @@ SOFTWARE.
 ******************************************************************************/
 #include <QString>
 #include <QJsonArray>
+#include <QJsonObject>
 #include <chrono>
 #include <array>
+#include <memory>
 #include <variant>
 #include <QHash>
 
@@ -38,6 +40,7 @@ struct Connection
 {
     Connection() = default;
     Connection(size_t val) { ConnectionID = val; }
+    Connection(size_t val, size_t session) { ConnectionID = val; SessionID = session; }
     Connection(const Connection&) = default;
     Connection& operator=(const Connection&) = default;
 
@@ -45,21 +48,23 @@ struct Connection
     Connection& operator=(Connection&&) = default;
 
     size_t ConnectionID{0};
+    size_t SessionID{0};            //网关连接上的逻辑会话,0 表示连接本身
 };
 
 inline bool operator<(const Connection& lhs,const Connection& rhs)
 {
-    return lhs.ConnectionID < rhs.ConnectionID;
+    return (lhs.ConnectionID < rhs.ConnectionID)
+            || ((lhs.ConnectionID == rhs.ConnectionID) && (lhs.SessionID < rhs.SessionID));
 }
 
 inline bool operator<=(const Connection& lhs,const Connection& rhs)
 {
-    return lhs.ConnectionID <= rhs.ConnectionID;
+    return !(rhs < lhs);
 }
 
 inline bool operator==(const Connection& lhs,const Connection& rhs)
 {
-    return lhs.ConnectionID == rhs.ConnectionID;
+    return (lhs.ConnectionID == rhs.ConnectionID) && (lhs.SessionID == rhs.SessionID);
 }
 
 struct User
@@ -122,13 +127,17 @@ struct ScheduledTask
     std::chrono::steady_clock::time_point next_tp;  //next invoke time
 };
 
+struct ComponentChangeWave;
+
 struct ComponentChangeEvent
 {
     Jimmy::User userid{0};
     QString cid;
-    QString trigger;
+    QString trigger;                                //合并的事件为最后一个触发来源
     QJsonValue value;
     size_t counter{0};
+    QJsonObject triggers;                           //batch 合并了两个以上触发来源时为所有来源及其值,否则为空
+    std::shared_ptr<ComponentChangeWave> wave;      //所属的 batch 波次,为空时不合并
 };
 
 }
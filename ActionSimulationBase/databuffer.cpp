@@ -25,6 +25,8 @@ SOFTWARE.
 
 #include "databuffer.h"
 #include <string>
+#include <cstring>
+#include <algorithm>
 #include <cassert>
 #include "logger.h"
 #include "commonconst.h"
@@ -34,10 +36,10 @@ using namespace std;
 namespace Jimmy {
 
 DataBuffer::DataBuffer()
-    :bufferSize_(1024 * 64)
+    :buffer_(nullptr)
+    , bufferSize_(0)
     , dataEndMark_(0)
 {
-    buffer_ = new uint8_t[bufferSize_];
 }
 
 DataBuffer::~DataBuffer()
@@ -51,6 +53,11 @@ DataBuffer::~DataBuffer()
 
 bool DataBuffer::appendData(const uint8_t* data, size_t length)
 {
+    if (length == 0)
+    {
+        return true;
+    }
+
     if ((dataEndMark_ + length) > bufferSize_)
     {
         if ((dataEndMark_ + length) > CommonConst::JsonBagMaxLength)
@@ -58,17 +65,21 @@ bool DataBuffer::appendData(const uint8_t* data, size_t length)
             return false;
         }
 
-        bufferSize_ += length;
+        size_t newSize = max(max(bufferSize_ * 2, InitialBufferSize), dataEndMark_ + length);
+        bufferSize_ = min(newSize, static_cast<size_t>(CommonConst::JsonBagMaxLength));
         uint8_t* pT = new uint8_t[bufferSize_];
 
-        memcpy_s(pT, bufferSize_, buffer_, dataEndMark_);
+        if (dataEndMark_ > 0)
+        {
+            memcpy(pT, buffer_, dataEndMark_);
+        }
         swap(pT, buffer_);
 
         delete[] pT;
         pT = nullptr;
     }
 
-    memcpy_s(&buffer_[dataEndMark_], bufferSize_ - dataEndMark_, data, length);
+    memcpy(&buffer_[dataEndMark_], data, length);
     dataEndMark_ += length;
     return true;
 }
@@ -98,6 +109,14 @@ const uint8_t* DataBuffer::getSubData(uint32_t start)
 void DataBuffer::clear()
 {
     dataEndMark_ = 0;
+
+    //大数据包处理完后归还内存,避免空闲连接长期占用
+    if (bufferSize_ > InitialBufferSize)
+    {
+        delete[] buffer_;
+        buffer_ = nullptr;
+        bufferSize_ = 0;
+    }
 }
 
 };
@@ -42,6 +42,8 @@ public:
     char getData(uint32_t pos);
     void clear();
 private:
+    static constexpr size_t InitialBufferSize = 1024;              //第一次写入时分配的大小,之后按 2 倍增长,clear 时超过该大小的缓冲区会被释放
+
     uint8_t* buffer_;
     size_t bufferSize_;
     size_t dataEndMark_;
@@ -23,179 +23,227 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 ******************************************************************************/
 
+#include <algorithm>
 #include "datapackage.h"
-#include "commonfunction.h"
+#include "commonconst.h"
+#include "jsonscanner.h"
 
 using namespace std;
 
 namespace Jimmy
 {
 
-MessageData* constructMsgPacket(size_t connection_id, const uint8_t* pData, size_t data_length)
+DataPackage::DataPackage(size_t connectionId)
+    :connectionId_(connectionId)
+    , framingMode_(FramingMode::Undecided)
+    , isQuotation_(false)
+    , isBackslash_(false)
+    , unmatchedLeftBraceNumbers_(0)
+    , hasFrameLength_(false)
+    , frameLength_(0)
 {
-	size_t size = sizeof(MessageData) + data_length;
-
-	MessageData* pMsgData = static_cast<MessageData*>(malloc(size));
-	pMsgData->connection_id = connection_id;
-	pMsgData->DataLength = data_length;
-	if (data_length > 0)
-	{
-		memcpy(pMsgData->Data, pData, data_length);
-	}
-
-	return pMsgData;
-}
-
-void destructMsgPacket(MessageData* p)
-{
-	if (p)
-	{
-		free((void*)p);
-		p = nullptr;
-	}
 }
 
-DataPackage::DataPackage()
-	:isRun_(true)
+DataPackage::~DataPackage()
 {
-	datagramOpThread_ = std::thread(std::bind(&DataPackage::datagramOpThread, this));
 }
 
-DataPackage::~DataPackage()
+bool DataPackage::pushData(const uint8_t* pData, size_t dataLength)
 {
-    isRun_ = false;
+    if ((framingMode_ == FramingMode::Undecided) && (dataLength > 0))
+    {
+        if (pData[0] == CommonConst::LengthPrefixMagic)
+        {
+            framingMode_ = FramingMode::LengthPrefix;
+            ++pData;
+            --dataLength;
+        }
+        else
+        {
+            framingMode_ = FramingMode::Brace;
+        }
+    }
 
-    if (datagramOpThread_.joinable())
+    if (framingMode_ == FramingMode::LengthPrefix)
     {
-        eventDatagramData_.notify_one();
-        datagramOpThread_.join();
+        return pushLengthPrefixData_(pData, dataLength);
     }
 
+    return pushBraceData_(pData, dataLength);
 }
 
-void DataPackage::pushData(size_t connectionId, const uint8_t* pData, size_t dataLength)
+void DataPackage::processMessage_(std::string&& message)
 {
-    MessageData* pRecData = constructMsgPacket(connectionId, pData, dataLength);
-
+    if (messageProcess_)
     {
-        lock_guard<mutex> lg(lockDatagramData_);
-        datagramData_.push_back(pRecData);
+        messageProcess_(connectionId_, message);
     }
-
-    eventDatagramData_.notify_one();
 }
 
-bool DataPackage::AnalyzeCommand(shared_ptr<DataBuffer> dest, MessageData* pRD)
+bool DataPackage::pushLengthPrefixData_(const uint8_t* pData, size_t dataLength)
 {
     size_t pos(0);
-    int start(-1);
-    bool isQuotation(false), isBackslash(false);
-    int unmatchedLeftBraceNumbers(0);
-
-    if (dest->getDataLength() > 0)
-    {
-        start = 0;
-        auto pT = dest->getData();
-        for (pos = 0; pos < dest->getDataLength(); ++pos)
-        {
-            CommonFunction::checkJsonChar(pT[pos], isBackslash, isQuotation, unmatchedLeftBraceNumbers);
-        }
-    }
-
-    for (pos = 0; pos < pRD->DataLength; ++pos)
+    while (pos < dataLength)
     {
-        CommonFunction::checkJsonChar(pRD->Data[pos], isBackslash, isQuotation, unmatchedLeftBraceNumbers);
-
-        if ((start == -1) && (unmatchedLeftBraceNumbers != 0))
-        {
-            start = pos;
-            continue;
-        }
-
-        if ((start != -1) && (unmatchedLeftBraceNumbers == 0))
+        if (!hasFrameLength_)
         {
-            std::string cacheData;
-            if (dest->getDataLength() > 0)
+            const uint8_t* header = &pData[pos];
+            if ((dataBuffer_.getDataLength() > 0) || (dataLength - pos < CommonConst::LengthPrefixSize))
             {
-                cacheData.append((const char*)dest->getData(), dest->getDataLength());
-                cacheData.append((char*)&pRD->Data, pos + 1);
-                dest->clear();
+                //长度被拆分到多次数据中
+                size_t count = std::min(CommonConst::LengthPrefixSize - dataBuffer_.getDataLength(), dataLength - pos);
+                dataBuffer_.appendData(&pData[pos], count);
+                pos += count;
+                if (dataBuffer_.getDataLength() < CommonConst::LengthPrefixSize)
+                {
+                    return true;
+                }
+
+                header = dataBuffer_.getData();
             }
             else
             {
-                cacheData.append((char*)&pRD->Data[start], pos - start + 1);
+                pos += CommonConst::LengthPrefixSize;
             }
 
-            if (messageProcess_)
+            frameLength_ = (static_cast<size_t>(header[0]) << 24) | (static_cast<size_t>(header[1]) << 16)
+                | (static_cast<size_t>(header[2]) << 8) | static_cast<size_t>(header[3]);
+            dataBuffer_.clear();
+
+            if (frameLength_ > static_cast<size_t>(CommonConst::JsonBagMaxLength))
             {
-                messageProcess_(pRD->connection_id, cacheData);
+                return false;
             }
 
-            start = -1;
-            unmatchedLeftBraceNumbers = 0;
+            hasFrameLength_ = true;
         }
-    }
 
-    if (start != -1)
-    {
-        if (dest->getDataLength() > 0)
+        size_t buffered = dataBuffer_.getDataLength();
+        size_t count = std::min(frameLength_ - buffered, dataLength - pos);
+        if ((buffered == 0) && (count == frameLength_))
         {
-            return dest->appendData(pRD->Data, pRD->DataLength);
+            //整包都在本次数据中,不经过缓冲区
+            if (frameLength_ > 0)
+            {
+                processMessage_(std::string((const char*)&pData[pos], count));
+            }
+            hasFrameLength_ = false;
         }
         else
         {
-            return dest->appendData(&pRD->Data[start], pRD->DataLength - start);
+            if (!dataBuffer_.appendData(&pData[pos], count))
+            {
+                return false;
+            }
+
+            if (dataBuffer_.getDataLength() == frameLength_)
+            {
+                processMessage_(std::string((const char*)dataBuffer_.getData(), frameLength_));
+                dataBuffer_.clear();
+                hasFrameLength_ = false;
+            }
         }
+        pos += count;
     }
 
     return true;
 }
 
-void DataPackage::datagramOpThread()
+bool DataPackage::pushBraceData_(const uint8_t* pData, size_t dataLength)
 {
-    unordered_map<size_t, shared_ptr<DataBuffer>> connectBuffer;
-    while (isRun_)
+    //缓冲区中有数据说明上一个包尚未结束,从本次数据的开头继续
+    bool inFrame = (dataBuffer_.getDataLength() > 0);
+    size_t start(0);
+    size_t pos(0);
+
+    //上次数据以字符串中的反斜杠结尾,跳过被转义的字符
+    if (isBackslash_ && (dataLength > 0))
+    {
+        isBackslash_ = false;
+        pos = 1;
+    }
+
+    //只有 { } " \ 会改变扫描状态,其余字符整段跳过
+    while ((pos = JsonScanner::findStructural(pData, pos, dataLength)) < dataLength)
     {
-        QQueue<MessageData*> DataBag;
+        char ch = static_cast<char>(pData[pos]);
+        if (isQuotation_)
         {
-            std::unique_lock<std::mutex> lg(lockDatagramData_);
-            eventDatagramData_.wait(lg, [this] {return !isRun_ || (!datagramData_.empty()); });
-            if (!isRun_) { break; }
-            DataBag.swap(datagramData_);
+            if (ch == CommonConst::BackSlash)
+            {
+                if (pos + 1 >= dataLength)
+                {
+                    isBackslash_ = true;
+                }
+                pos += 2;
+                continue;
+            }
+
+            if (ch == CommonConst::Quotation)
+            {
+                isQuotation_ = false;
+            }
+            ++pos;
+            continue;
         }
 
-        while (!DataBag.empty())
+        switch (ch)
         {
-            MessageData* pData = DataBag.dequeue();
-
-            if (pData->DataLength == 0)
+        case CommonConst::Quotation:
+        {
+            //包外的引号不属于任何字符串,忽略,避免之后的包都被当作字符串内容
+            if (inFrame)
             {
-                connectBuffer.erase(pData->connection_id);
+                isQuotation_ = true;
             }
-            else
+            break;
+        }
+        case CommonConst::JSONSTART:
+        {
+            if (!inFrame)
             {
-                auto itor = connectBuffer.find(pData->connection_id);
-                if (itor == connectBuffer.end())
-                {
-                    shared_ptr<DataBuffer> pDB = make_shared<DataBuffer>();
-                    AnalyzeCommand(pDB, pData);
-                    connectBuffer.insert(make_pair(pData->connection_id, pDB));
-                }
-                else
+                inFrame = true;
+                start = pos;
+            }
+            ++unmatchedLeftBraceNumbers_;
+            break;
+        }
+        case CommonConst::JSONSEND:
+        {
+            if (unmatchedLeftBraceNumbers_ > 0)
+            {
+                --unmatchedLeftBraceNumbers_;
+            }
+
+            if (inFrame && (unmatchedLeftBraceNumbers_ == 0))
+            {
+                std::string cacheData;
+                if (dataBuffer_.getDataLength() > 0)
                 {
-                    if (!AnalyzeCommand(itor->second, pData))
-                    {
-                        //无效数据超出缓冲区最大值，踢掉该连接
-                        if (blacklistFunc_)
-                        {
-                            blacklistFunc_(pData->connection_id);
-                        }
-                    }
+                    cacheData.reserve(dataBuffer_.getDataLength() + pos - start + 1);
+                    cacheData.append((const char*)dataBuffer_.getData(), dataBuffer_.getDataLength());
+                    dataBuffer_.clear();
                 }
+                cacheData.append((const char*)&pData[start], pos - start + 1);
+
+                processMessage_(std::move(cacheData));
+
+                inFrame = false;
             }
-            destructMsgPacket(pData);
+            break;
         }
+        default:
+            break;
+        }
+        ++pos;
     }
+
+    if (inFrame)
+    {
+        return dataBuffer_.appendData(&pData[start], dataLength - start);
+    }
+
+    return true;
 }
 
 }
@@ -23,57 +23,59 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 ******************************************************************************/
 
-#include <thread>
-#include <mutex>
-#include <QQueue>
 #include <memory>
+#include <string>
+#include <QtGlobal>
 #include <functional>
 #include "databuffer.h"
 
 namespace Jimmy
 {
 
-struct MessageData
+//分包方式,由连接收到的第一个字节决定
+enum class FramingMode
 {
-	size_t		connection_id;
-	size_t		DataLength;
-	uint8_t		Data[1];
+    Undecided,
+    Brace,                                                      //按大括号匹配拆分 JSON
+    LengthPrefix,                                               //4 字节大端长度 + 数据
 };
 
-class TcpServer;
-
+//单个连接的组包器,在该连接的 io 线程上同步调用,不需要加锁
 class DataPackage
 {
+    Q_DISABLE_COPY(DataPackage)
 public:
-    DataPackage();
+    DataPackage(size_t connectionId);
     ~DataPackage();
 
     //组包成功调用函数
     void registerMessageProcessFunction(std::function<void(size_t,const std::string&)> messageProcess)
     {
         messageProcess_ = messageProcess;
-	}
+    }
 
-    //黑名单调用函数
-	void registerblacklistFunction(std::function<void(size_t)> blackConnect)
-	{
-        blacklistFunc_ = blackConnect;
-	}
+    //返回 false 表示未完成的数据超出缓冲区最大值
+    bool pushData(const uint8_t* pData, size_t dataLength);
 
-    void pushData(size_t connectionId, const uint8_t* pData, size_t dataLength);
+    FramingMode getFramingMode() const { return framingMode_; }
+private:
+    bool pushBraceData_(const uint8_t* pData, size_t dataLength);
+    bool pushLengthPrefixData_(const uint8_t* pData, size_t dataLength);
+    void processMessage_(std::string&& message);
 private:
-    bool AnalyzeCommand(std::shared_ptr<Jimmy::DataBuffer> dest, MessageData* pRD);
-    void datagramOpThread();
-    std::thread	datagramOpThread_;
+    const size_t connectionId_;
+    FramingMode framingMode_;
+    DataBuffer dataBuffer_;                                     //未完成的数据包,其中的字节已扫描过
 
-    QQueue<MessageData*> datagramData_;
-    std::mutex lockDatagramData_;
-    std::condition_variable eventDatagramData_;
+    //扫描状态跨越多次 pushData 保持,每个字节只扫描一次
+    bool isQuotation_;
+    bool isBackslash_;
+    int unmatchedLeftBraceNumbers_;
 
-    bool isRun_;
+    bool hasFrameLength_;                                       //LengthPrefix 模式下已读到当前包的长度
+    size_t frameLength_;
 
     std::function<void(size_t, const std::string&)> messageProcess_;
-    std::function<void(size_t)> blacklistFunc_;
 };
 
 };
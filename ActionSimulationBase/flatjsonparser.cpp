@@ -0,0 +1,364 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "flatjsonparser.h"
+#include <QByteArray>
+#include <cmath>
+
+namespace Jimmy
+{
+
+//从 data 开始的 UTF-8 编码字符的字节数,不合法(过长编码、代理区、超过 U+10FFFF、截断)时返回 0
+static size_t utf8SequenceLength(const uint8_t* data, const uint8_t* end)
+{
+    uint8_t lead = data[0];
+    size_t length(0);
+    uint8_t lower(0x80);
+    uint8_t upper(0xBF);
+    if ((lead >= 0xC2) && (lead <= 0xDF))
+    {
+        length = 2;
+    }
+    else if ((lead >= 0xE0) && (lead <= 0xEF))
+    {
+        length = 3;
+        if (lead == 0xE0)
+        {
+            lower = 0xA0;
+        }
+        else if (lead == 0xED)
+        {
+            upper = 0x9F;
+        }
+    }
+    else if ((lead >= 0xF0) && (lead <= 0xF4))
+    {
+        length = 4;
+        if (lead == 0xF0)
+        {
+            lower = 0x90;
+        }
+        else if (lead == 0xF4)
+        {
+            upper = 0x8F;
+        }
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (static_cast<size_t>(end - data) < length)
+    {
+        return 0;
+    }
+
+    //只有第二个字节的范围与首字节有关
+    if ((data[1] < lower) || (data[1] > upper))
+    {
+        return 0;
+    }
+
+    for (size_t i = 2; i < length; ++i)
+    {
+        if ((data[i] < 0x80) || (data[i] > 0xBF))
+        {
+            return 0;
+        }
+    }
+
+    return length;
+}
+
+bool FlatJsonParser::parse(const char* data, size_t length)
+{
+    pos_ = data;
+    end_ = data + length;
+    fieldCount_ = 0;
+
+    skipSpace_();
+    if ((pos_ == end_) || (*pos_ != '{'))
+    {
+        return false;
+    }
+
+    ++pos_;
+    skipSpace_();
+    if ((pos_ != end_) && (*pos_ == '}'))
+    {
+        ++pos_;
+        skipSpace_();
+        return pos_ == end_;
+    }
+
+    while (true)
+    {
+        if (fieldCount_ == MaxFieldCount)
+        {
+            return false;
+        }
+
+        Field field;
+        if (!parseString_(field.key))
+        {
+            return false;
+        }
+
+        if (find(field.key) != nullptr)
+        {
+            return false;
+        }
+
+        skipSpace_();
+        if ((pos_ == end_) || (*pos_ != ':'))
+        {
+            return false;
+        }
+
+        ++pos_;
+        skipSpace_();
+        if (pos_ == end_)
+        {
+            return false;
+        }
+
+        switch (*pos_)
+        {
+        case '"':
+            field.type = QJsonValue::String;
+            if (!parseString_(field.raw))
+            {
+                return false;
+            }
+            break;
+        case 't':
+            field.type = QJsonValue::Bool;
+            field.raw = std::string_view(pos_, 4);
+            if (!parseLiteral_("true"))
+            {
+                return false;
+            }
+            break;
+        case 'f':
+            field.type = QJsonValue::Bool;
+            field.raw = std::string_view(pos_, 5);
+            if (!parseLiteral_("false"))
+            {
+                return false;
+            }
+            break;
+        case 'n':
+            field.type = QJsonValue::Null;
+            if (!parseLiteral_("null"))
+            {
+                return false;
+            }
+            break;
+        default:
+            //对象和数组交给 QJsonDocument
+            field.type = QJsonValue::Double;
+            if (!parseNumber_(field.raw, field.number))
+            {
+                return false;
+            }
+            break;
+        }
+
+        fields_[fieldCount_++] = field;
+
+        skipSpace_();
+        if (pos_ == end_)
+        {
+            return false;
+        }
+
+        if (*pos_ == '}')
+        {
+            ++pos_;
+            break;
+        }
+
+        if (*pos_ != ',')
+        {
+            return false;
+        }
+
+        ++pos_;
+        skipSpace_();
+    }
+
+    skipSpace_();
+    return pos_ == end_;
+}
+
+const FlatJsonParser::Field* FlatJsonParser::find(std::string_view key) const
+{
+    for (size_t i = 0; i < fieldCount_; ++i)
+    {
+        if (fields_[i].key == key)
+        {
+            return &fields_[i];
+        }
+    }
+
+    return nullptr;
+}
+
+QString FlatJsonParser::toString(const Field& field)
+{
+    return QString::fromUtf8(field.raw.data(), static_cast<int>(field.raw.size()));
+}
+
+QJsonValue FlatJsonParser::toValue(const Field& field)
+{
+    switch (field.type)
+    {
+    case QJsonValue::String: return QJsonValue(toString(field));
+    case QJsonValue::Bool: return QJsonValue(field.raw.size() == 4);
+    case QJsonValue::Double: return QJsonValue(field.number);
+    default: return QJsonValue(QJsonValue::Null);
+    }
+}
+
+bool FlatJsonParser::parseString_(std::string_view& value)
+{
+    if ((pos_ == end_) || (*pos_ != '"'))
+    {
+        return false;
+    }
+
+    const char* begin = ++pos_;
+    while (pos_ != end_)
+    {
+        auto ch = static_cast<uint8_t>(*pos_);
+        if (ch == '"')
+        {
+            value = std::string_view(begin, static_cast<size_t>(pos_ - begin));
+            ++pos_;
+            return true;
+        }
+
+        //转义字符需要还原,控制字符不合法,均交给 QJsonDocument 处理
+        if ((ch == '\\') || (ch < 0x20))
+        {
+            return false;
+        }
+
+        if (ch < 0x80)
+        {
+            ++pos_;
+            continue;
+        }
+
+        size_t length = utf8SequenceLength(reinterpret_cast<const uint8_t*>(pos_), reinterpret_cast<const uint8_t*>(end_));
+        if (length == 0)
+        {
+            return false;
+        }
+
+        pos_ += length;
+    }
+
+    return false;
+}
+
+bool FlatJsonParser::parseNumber_(std::string_view& value, double& number)
+{
+    const char* begin = pos_;
+    auto isDigit = [this]() { return (pos_ != end_) && (*pos_ >= '0') && (*pos_ <= '9'); };
+
+    if ((pos_ != end_) && (*pos_ == '-'))
+    {
+        ++pos_;
+    }
+
+    if (!isDigit())
+    {
+        return false;
+    }
+
+    if (*pos_ == '0')
+    {
+        ++pos_;
+    }
+    else
+    {
+        while (isDigit()) { ++pos_; }
+    }
+
+    if ((pos_ != end_) && (*pos_ == '.'))
+    {
+        ++pos_;
+        if (!isDigit())
+        {
+            return false;
+        }
+        while (isDigit()) { ++pos_; }
+    }
+
+    if ((pos_ != end_) && ((*pos_ == 'e') || (*pos_ == 'E')))
+    {
+        ++pos_;
+        if ((pos_ != end_) && ((*pos_ == '+') || (*pos_ == '-')))
+        {
+            ++pos_;
+        }
+        if (!isDigit())
+        {
+            return false;
+        }
+        while (isDigit()) { ++pos_; }
+    }
+
+    value = std::string_view(begin, static_cast<size_t>(pos_ - begin));
+
+    //语法正确但超出 double 范围(如 1e999)的数值交给 QJsonDocument
+    bool ok(false);
+    number = QByteArray::fromRawData(begin, static_cast<int>(value.size())).toDouble(&ok);
+    return ok && std::isfinite(number);
+}
+
+bool FlatJsonParser::parseLiteral_(const char* literal)
+{
+    for (; *literal != '\0'; ++literal, ++pos_)
+    {
+        if ((pos_ == end_) || (*pos_ != *literal))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FlatJsonParser::skipSpace_()
+{
+    while ((pos_ != end_) && ((*pos_ == ' ') || (*pos_ == '\t') || (*pos_ == '\r') || (*pos_ == '\n')))
+    {
+        ++pos_;
+    }
+}
+
+}
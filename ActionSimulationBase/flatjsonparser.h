@@ -0,0 +1,74 @@
+﻿#pragma once
+
+/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <array>
+#include <string_view>
+#include <QString>
+#include <QJsonValue>
+
+namespace Jimmy
+{
+
+//只有一层的 JSON 对象在 UTF-8 数据上直接解析,不建立 QJsonDocument
+//值为对象或数组、字符串含转义字符、重复的字段名或字段过多时返回 false,由调用者改用 QJsonDocument
+//字符串不是合法的 UTF-8 或数值超出 double 范围时同样返回 false
+class FlatJsonParser
+{
+public:
+    struct Field
+    {
+        std::string_view key;
+        std::string_view raw;                   //字符串不含引号
+        QJsonValue::Type type{QJsonValue::Null};
+        double number{0};                       //type 为 Double 时解析后的值
+    };
+
+    FlatJsonParser() = default;
+
+    bool parse(const char* data, size_t length);
+
+    //不存在时返回 nullptr
+    const Field* find(std::string_view key) const;
+
+    static QString toString(const Field& field);
+    static QJsonValue toValue(const Field& field);
+private:
+    bool parseString_(std::string_view& value);
+    bool parseNumber_(std::string_view& value, double& number);
+    bool parseLiteral_(const char* literal);
+    void skipSpace_();
+private:
+    static const size_t MaxFieldCount = 8;
+
+    const char* pos_{nullptr};
+    const char* end_{nullptr};
+
+    std::array<Field, MaxFieldCount> fields_;
+    size_t fieldCount_{0};
+};
+
+}
@@ -0,0 +1,164 @@
+﻿#pragma once
+
+/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <QtGlobal>
+
+namespace Jimmy
+{
+
+//异步操作完成函数的内存,同一时刻只服务一个未完成的操作,完成后重复使用
+//正在使用时退回到堆分配;操作对象超出 Size 在编译期报错,而不是悄悄走堆
+template <std::size_t Size>
+class HandlerMemory
+{
+    Q_DISABLE_COPY(HandlerMemory)
+public:
+    HandlerMemory()
+        :inUse_(false)
+    {
+    }
+
+    void* allocate(std::size_t size)
+    {
+        if (!inUse_ && (size <= sizeof(storage_)))
+        {
+            inUse_ = true;
+            return &storage_;
+        }
+
+        return ::operator new(size);
+    }
+
+    void deallocate(void* pointer)
+    {
+        if (pointer == &storage_)
+        {
+            inUse_ = false;
+        }
+        else
+        {
+            ::operator delete(pointer);
+        }
+    }
+
+private:
+    typename std::aligned_storage<Size>::type storage_;
+    bool inUse_;
+};
+
+//通过 asio 的 associated_allocator 让异步操作从 HandlerMemory 分配内存
+template <typename T, std::size_t Size>
+class HandlerAllocator
+{
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = HandlerAllocator<U, Size>;
+    };
+
+    explicit HandlerAllocator(HandlerMemory<Size>& memory)
+        :memory_(memory)
+    {
+    }
+
+    template <typename U>
+    HandlerAllocator(const HandlerAllocator<U, Size>& other) noexcept
+        :memory_(other.memory_)
+    {
+    }
+
+    bool operator==(const HandlerAllocator& other) const noexcept
+    {
+        return &memory_ == &other.memory_;
+    }
+
+    bool operator!=(const HandlerAllocator& other) const noexcept
+    {
+        return &memory_ != &other.memory_;
+    }
+
+    T* allocate(std::size_t n) const
+    {
+        static_assert(sizeof(T) <= Size, "asio operation does not fit in HandlerMemory, enlarge the slot");
+
+        return static_cast<T*>(memory_.allocate(sizeof(T) * n));
+    }
+
+    void deallocate(T* p, std::size_t /*n*/) const
+    {
+        return memory_.deallocate(p);
+    }
+
+private:
+    template <typename, std::size_t> friend class HandlerAllocator;
+
+    HandlerMemory<Size>& memory_;
+};
+
+template <typename Handler, std::size_t Size>
+class CustomAllocHandler
+{
+public:
+    using allocator_type = HandlerAllocator<Handler, Size>;
+
+    CustomAllocHandler(HandlerMemory<Size>& memory, Handler handler)
+        :memory_(memory)
+        , handler_(std::move(handler))
+    {
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return allocator_type(memory_);
+    }
+
+    template <typename ...Args>
+    void operator()(Args&&... args)
+    {
+        handler_(std::forward<Args>(args)...);
+    }
+
+private:
+    HandlerMemory<Size>& memory_;
+    Handler handler_;
+};
+
+template <typename Handler, std::size_t Size>
+inline CustomAllocHandler<Handler, Size> makeCustomAllocHandler(HandlerMemory<Size>& memory, Handler handler)
+{
+    return CustomAllocHandler<Handler, Size>(memory, std::move(handler));
+}
+
+}
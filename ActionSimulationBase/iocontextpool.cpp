@@ -31,25 +31,84 @@ using namespace std;
 
 namespace Jimmy {
 
-IoContextPool::IoContextPool(bool is_single)
+IoContextPool::IoContextPool(size_t pool_size)
     : nextIoContext_(0)
     , status_(status::stopped)
-    , isSingle_(is_single)
 {
-    size_t num = isSingle_ ? 1 : thread::hardware_concurrency();
-    for (auto i = 0; i < num; ++i)
+    size_t num = (pool_size == 0) ? thread::hardware_concurrency() : pool_size;
+    if (num == 0)
+    {
+        num = 1;
+    }
+
+    for (size_t i = 0; i < num; ++i)
     {
         io_context_ptr io_context(new boost::asio::io_context);
         ioContexts_.push_back(io_context);
+        timerWheels_.push_back(make_shared<TimerWheel>(*io_context));
         work_.push_back(boost::asio::make_work_guard(*io_context));
     }
 }
 
+const char* IoContextPool::backendName()
+{
+#if defined(BOOST_ASIO_HAS_IO_URING_AS_DEFAULT)
+    return "io_uring";
+#elif defined(BOOST_ASIO_HAS_IOCP)
+    return "iocp";
+#elif defined(BOOST_ASIO_HAS_EPOLL)
+    return "epoll";
+#elif defined(BOOST_ASIO_HAS_KQUEUE)
+    return "kqueue";
+#else
+    return "select";
+#endif
+}
+
+bool IoContextPool::checkBackend(QString& error)
+{
+    //io_context 在创建第一个 I/O 对象时才初始化后端,这里打开一个 socket 并完成一次异步等待
+    try
+    {
+        boost::asio::io_context ic;
+        boost::asio::ip::tcp::socket socket(ic);
+        socket.open(boost::asio::ip::tcp::v4());
+
+        boost::system::error_code waitError = boost::asio::error::would_block;
+        boost::asio::steady_timer timer(ic, std::chrono::steady_clock::now());
+        timer.async_wait([&waitError](const boost::system::error_code& ec)
+        {
+            waitError = ec;
+        });
+        ic.run_for(std::chrono::seconds(1));
+
+        if (waitError == boost::asio::error::would_block)
+        {
+            error = QStringLiteral("async wait did not complete");
+            return false;
+        }
+
+        if (waitError)
+        {
+            error = QString::fromLocal8Bit(waitError.message().c_str());
+            return false;
+        }
+    }
+    catch (const boost::system::system_error& e)
+    {
+        error = QString::fromLocal8Bit(e.what());
+        return false;
+    }
+
+    return true;
+}
+
 IoContextPool::~IoContextPool()
 {
     stop();
 
     work_.clear();
+    timerWheels_.clear();
     ioContexts_.clear();
 }
 
@@ -60,6 +119,7 @@ void IoContextPool::run()
         status_ = status::running;
         for (int i = 0; i < ioContexts_.size(); ++i)
         {
+            timerWheels_[i]->start();
             shared_ptr<thread> athread(new thread(boost::bind(&boost::asio::io_context::run, ioContexts_[i])));
             threads_.push_back(athread);
         }
@@ -107,21 +167,37 @@ void IoContextPool::stop()
     }
 }
 
+size_t IoContextPool::size() const
+{
+    return ioContexts_.size();
+}
+
 boost::asio::io_context& IoContextPool::getIoContext()
 {
-    if (isSingle_)
+    if (ioContexts_.size() == 1)
     {
         return *ioContexts_[0];
     }
 
-    boost::asio::io_context& io_context = *ioContexts_[nextIoContext_];
-    ++nextIoContext_;
-    if (nextIoContext_ == ioContexts_.size())
+    return *ioContexts_[nextIoContext_.fetch_add(1, memory_order_relaxed) % ioContexts_.size()];
+}
+
+TimerWheel& IoContextPool::getTimerWheel(boost::asio::io_context& ic)
+{
+    for (int i = 0; i < ioContexts_.size(); ++i)
     {
-        nextIoContext_ = 0;
+        if (ioContexts_[i].get() == &ic)
+        {
+            return *timerWheels_[i];
+        }
     }
 
-    return io_context;
+    throw std::out_of_range("io_context is not in the pool");
+}
+
+boost::asio::io_context& IoContextPool::getIoContext(size_t index)
+{
+    return *ioContexts_[index % ioContexts_.size()];
 }
 
 }
@@ -26,8 +26,11 @@ SOFTWARE.
 ******************************************************************************/
 
 #include <boost/asio.hpp>
+#include <atomic>
 #include <QVector>
 #include <QList>
+#include <QString>
+#include "timerwheel.h"
 
 namespace Jimmy
 {
@@ -35,12 +38,27 @@ class IoContextPool
 {
     Q_DISABLE_COPY(IoContextPool)
 public:
-    IoContextPool(bool is_single = true);
+    //pool_size 为 io_context 数量,0 表示与 CPU 核数相同
+    IoContextPool(size_t pool_size = 1);
     ~IoContextPool();
     void run();
     void pause();
     void stop();
+
+    size_t size() const;
+
+    //轮询获取 io_context,可在任意线程调用
     boost::asio::io_context& getIoContext();
+    boost::asio::io_context& getIoContext(size_t index);
+
+    //ic 所属的时间轮,只能在 ic 的线程上使用
+    TimerWheel& getTimerWheel(boost::asio::io_context& ic);
+
+    //asio 的 I/O 后端在编译时确定,CONFIG+=io_uring 编译时为 io_uring
+    static const char* backendName();
+
+    //用真实的 socket 和异步等待检查当前系统能否使用 I/O 后端,例如内核不支持 io_uring 时返回 false
+    static bool checkBackend(QString& error);
 
 private:
     using io_context_ptr = std::shared_ptr<boost::asio::io_context>;
@@ -48,9 +66,10 @@ private:
 
     QVector<std::shared_ptr<std::thread>> threads_;
     QVector<io_context_ptr> ioContexts_;
+    QVector<std::shared_ptr<TimerWheel>> timerWheels_;
     QList<io_context_work> work_;
 
-    std::size_t nextIoContext_;
+    std::atomic<std::size_t> nextIoContext_;
 
     enum class status
     {
@@ -60,7 +79,6 @@ private:
     };
 
     status status_;
-    bool isSingle_;
 };
 
 }
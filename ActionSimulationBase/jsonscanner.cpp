@@ -0,0 +1,236 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <algorithm>
+#include "jsonscanner.h"
+#include "commonconst.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define JSONSCANNER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//32 位 GCC 缺省不启用 SSE2,与 AVX2 一样按函数指定指令集
+#if defined(__GNUC__) || defined(__clang__)
+#define JSONSCANNER_TARGET_SSE2 __attribute__((target("sse2")))
+#define JSONSCANNER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define JSONSCANNER_TARGET_SSE2
+#define JSONSCANNER_TARGET_AVX2
+#endif
+
+namespace Jimmy
+{
+
+namespace JsonScanner
+{
+
+static inline bool isStructural(uint8_t ch)
+{
+    return (ch == CommonConst::JSONSTART) || (ch == CommonConst::JSONSEND)
+        || (ch == CommonConst::Quotation) || (ch == CommonConst::BackSlash);
+}
+
+static size_t findScalar(const uint8_t* data, size_t pos, size_t length)
+{
+    for (; pos < length; ++pos)
+    {
+        if (isStructural(data[pos]))
+        {
+            return pos;
+        }
+    }
+
+    return length;
+}
+
+#ifdef JSONSCANNER_X86
+
+static inline unsigned int lowestBit(uint32_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+JSONSCANNER_TARGET_SSE2
+static size_t findSSE2(const uint8_t* data, size_t pos, size_t length)
+{
+    const __m128i leftBrace = _mm_set1_epi8(CommonConst::JSONSTART);
+    const __m128i rightBrace = _mm_set1_epi8(CommonConst::JSONSEND);
+    const __m128i quotation = _mm_set1_epi8(CommonConst::Quotation);
+    const __m128i backSlash = _mm_set1_epi8(CommonConst::BackSlash);
+
+    for (; pos + 16 <= length; pos += 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, leftBrace), _mm_cmpeq_epi8(block, rightBrace)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, quotation), _mm_cmpeq_epi8(block, backSlash)));
+
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+        if (mask != 0)
+        {
+            return pos + lowestBit(mask);
+        }
+    }
+
+    return findScalar(data, pos, length);
+}
+
+JSONSCANNER_TARGET_AVX2
+static size_t findAVX2(const uint8_t* data, size_t pos, size_t length)
+{
+    const __m256i leftBrace = _mm256_set1_epi8(CommonConst::JSONSTART);
+    const __m256i rightBrace = _mm256_set1_epi8(CommonConst::JSONSEND);
+    const __m256i quotation = _mm256_set1_epi8(CommonConst::Quotation);
+    const __m256i backSlash = _mm256_set1_epi8(CommonConst::BackSlash);
+
+    for (; pos + 32 <= length; pos += 32)
+    {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i hit = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, leftBrace), _mm256_cmpeq_epi8(block, rightBrace)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, quotation), _mm256_cmpeq_epi8(block, backSlash)));
+
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask != 0)
+        {
+            return pos + lowestBit(mask);
+        }
+    }
+
+    return findSSE2(data, pos, length);
+}
+
+static bool supportAVX2()
+{
+#ifdef _MSC_VER
+    int info[4] = { 0 };
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    //需要操作系统保存 YMM 寄存器
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!(osxsave && avx) || ((_xgetbv(0) & 0x6) != 0x6))
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool supportSSE2()
+{
+#ifdef _MSC_VER
+    int info[4] = { 0 };
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+#endif
+
+using FindFunction = size_t(*)(const uint8_t*, size_t, size_t);
+
+//逐字节检查的长度,见 findStructural
+static const size_t ScalarPrefixLength = 16;
+
+struct Backend
+{
+    FindFunction find;
+    const char* name;
+};
+
+static Backend selectBackend()
+{
+#ifdef JSONSCANNER_X86
+    if (supportAVX2())
+    {
+        return { findAVX2, "avx2" };
+    }
+
+    if (supportSSE2())
+    {
+        return { findSSE2, "sse2" };
+    }
+#endif
+    return { findScalar, "scalar" };
+}
+
+static const Backend& backend()
+{
+    static const Backend selected = selectBackend();
+    return selected;
+}
+
+size_t findStructural(const uint8_t* data, size_t pos, size_t length)
+{
+    //消息中结构字符通常间隔很近,先逐字节检查一小段,找不到再按块查找
+    size_t prefixEnd = std::min(pos + ScalarPrefixLength, length);
+    for (; pos < prefixEnd; ++pos)
+    {
+        if (isStructural(data[pos]))
+        {
+            return pos;
+        }
+    }
+
+    return backend().find(data, pos, length);
+}
+
+const char* backendName()
+{
+    return backend().name;
+}
+
+size_t findStructuralScalar(const uint8_t* data, size_t pos, size_t length)
+{
+    return findScalar(data, pos, length);
+}
+
+}
+
+}
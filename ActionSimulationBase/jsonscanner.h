@@ -0,0 +1,49 @@
+﻿#pragma once
+
+/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <cstdint>
+#include <cstddef>
+
+namespace Jimmy
+{
+
+//JSON 组包用的结构字符查找,按 CPU 支持在运行时选择 AVX2/SSE2/逐字节实现
+namespace JsonScanner
+{
+
+//返回 [pos, length) 中第一个 { } " \ 的位置,没有时返回 length
+size_t findStructural(const uint8_t* data, size_t pos, size_t length);
+
+//当前使用的实现名称: avx2 / sse2 / scalar
+const char* backendName();
+
+//逐字节实现,用于校验和对比
+size_t findStructuralScalar(const uint8_t* data, size_t pos, size_t length);
+
+}
+
+}
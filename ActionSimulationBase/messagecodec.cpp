@@ -0,0 +1,264 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "messagecodec.h"
+#include <QCborStreamWriter>
+#include <QCborValue>
+#include <QCborMap>
+#include <QCborArray>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QHash>
+#include <cmath>
+
+namespace Jimmy
+{
+
+const char* const MessageCodec::keyTable[] =
+{
+    "action",
+    "cid",
+    "value",
+    "result",
+    "reason",
+    "sid",
+    "h",
+    "v",
+    "userid",
+    "role",
+    "changes",
+    "handle",
+    "codec",
+    "values",
+    "seq",
+};
+
+const int MessageCodec::KeyCount = static_cast<int>(sizeof(keyTable) / sizeof(keyTable[0]));
+
+QByteArray MessageCodec::toJson(const QJsonObject& message)
+{
+    return QJsonDocument(message).toJson(QJsonDocument::Compact);
+}
+
+QByteArray MessageCodec::toCbor(const QJsonObject& message)
+{
+    QByteArray data;
+    QCborStreamWriter writer(&data);
+    writeObject_(writer, message);
+    return data;
+}
+
+bool MessageCodec::isCbor(const char* data, size_t length)
+{
+    return (length > 0) && ((static_cast<unsigned char>(data[0]) & 0xE0) == 0xA0);
+}
+
+bool MessageCodec::fromCbor(const QByteArray& data, QJsonObject& message, QString& error)
+{
+    QCborParserError parserError;
+    auto value = QCborValue::fromCbor(data, &parserError);
+    if (parserError.error != QCborError::NoError)
+    {
+        error = parserError.errorString();
+        return false;
+    }
+
+    if (parserError.offset != data.size())
+    {
+        error = QStringLiteral("garbage at end of message");
+        return false;
+    }
+
+    if (!value.isMap())
+    {
+        error = QStringLiteral("message is not a map");
+        return false;
+    }
+
+    return readObject_(value, message, error);
+}
+
+int MessageCodec::keyIndex(const QString& key)
+{
+    static const QHash<QString, int> keys = []()
+    {
+        QHash<QString, int> ret;
+        for (int i = 0; i < KeyCount; ++i)
+        {
+            ret.insert(QString::fromLatin1(keyTable[i]), i);
+        }
+        return ret;
+    }();
+
+    return keys.value(key, -1);
+}
+
+void MessageCodec::writeObject_(QCborStreamWriter& writer, const QJsonObject& object)
+{
+    writer.startMap(static_cast<quint64>(object.size()));
+    for (auto itor = object.constBegin(); itor != object.constEnd(); ++itor)
+    {
+        int index = keyIndex(itor.key());
+        if (index >= 0)
+        {
+            writer.append(static_cast<quint64>(index));
+        }
+        else
+        {
+            writer.append(itor.key());
+        }
+
+        writeValue_(writer, itor.value());
+    }
+    writer.endMap();
+}
+
+void MessageCodec::writeValue_(QCborStreamWriter& writer, const QJsonValue& value)
+{
+    switch (value.type())
+    {
+    case QJsonValue::Bool:
+        writer.append(value.toBool());
+        break;
+    case QJsonValue::Double:
+    {
+        //与 QCborValue::fromJsonValue 一致,整数值按整数编码
+        double number = value.toDouble();
+        if ((std::trunc(number) == number) && (number >= -9007199254740992.0) && (number <= 9007199254740992.0))
+        {
+            writer.append(static_cast<qint64>(number));
+        }
+        else
+        {
+            writer.append(number);
+        }
+        break;
+    }
+    case QJsonValue::String:
+        writer.append(value.toString());
+        break;
+    case QJsonValue::Array:
+    {
+        auto array = value.toArray();
+        writer.startArray(static_cast<quint64>(array.size()));
+        foreach (const auto& item, array)
+        {
+            writeValue_(writer, item);
+        }
+        writer.endArray();
+        break;
+    }
+    case QJsonValue::Object:
+        writeObject_(writer, value.toObject());
+        break;
+    default:
+        writer.appendNull();
+        break;
+    }
+}
+
+bool MessageCodec::readObject_(const QCborValue& value, QJsonObject& object, QString& error)
+{
+    auto map = value.toMap();
+    for (auto itor = map.constBegin(); itor != map.constEnd(); ++itor)
+    {
+        QString key;
+        auto cborKey = itor.key();
+        if (cborKey.isInteger())
+        {
+            auto index = cborKey.toInteger();
+            if ((index < 0) || (index >= KeyCount))
+            {
+                error = QStringLiteral("unknown key %1").arg(index);
+                return false;
+            }
+
+            key = QString::fromLatin1(keyTable[index]);
+        }
+        else if (cborKey.isString())
+        {
+            key = cborKey.toString();
+        }
+        else
+        {
+            error = QStringLiteral("key is not a string or integer");
+            return false;
+        }
+
+        QJsonValue item;
+        if (!readValue_(itor.value(), item, error))
+        {
+            return false;
+        }
+
+        object.insert(key, item);
+    }
+
+    return true;
+}
+
+bool MessageCodec::readValue_(const QCborValue& value, QJsonValue& ret, QString& error)
+{
+    if (value.isMap())
+    {
+        QJsonObject object;
+        if (!readObject_(value, object, error))
+        {
+            return false;
+        }
+
+        ret = object;
+        return true;
+    }
+
+    if (value.isArray())
+    {
+        QJsonArray array;
+        foreach (const auto& item, value.toArray())
+        {
+            QJsonValue element;
+            if (!readValue_(item, element, error))
+            {
+                return false;
+            }
+            array.append(element);
+        }
+
+        ret = array;
+        return true;
+    }
+
+    if (value.isInteger())
+    {
+        ret = QJsonValue(value.toInteger());
+        return true;
+    }
+
+    //其他简单类型按 Qt 的规则转换,undefined 转为 null
+    ret = value.toJsonValue();
+    return true;
+}
+
+}
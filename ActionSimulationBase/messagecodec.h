@@ -0,0 +1,65 @@
+﻿#pragma once
+
+/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QByteArray>
+#include <QString>
+#include <QJsonObject>
+
+class QCborStreamWriter;
+class QCborValue;
+
+namespace Jimmy
+{
+
+//发送的消息以 QJsonObject 传到发送边界,按连接协商的编码直接序列化,不经过中间的 json 文本
+//cbor 编码时常用字段名以整数代替(0 起,见 keyTable),解码时还原;其他字段名和所有字符串均为 UTF-8
+class MessageCodec
+{
+public:
+    static QByteArray toJson(const QJsonObject& message);
+    static QByteArray toCbor(const QJsonObject& message);
+
+    //首字节为 cbor map 类型(0xA0-0xBF)时返回 true,json 消息总以 '{' 开头,两者不会混淆
+    static bool isCbor(const char* data, size_t length);
+
+    //data 不是单个 cbor map、字段名不是字符串或未知的整数时返回 false,error 为错误原因
+    static bool fromCbor(const QByteArray& data, QJsonObject& message, QString& error);
+
+    //整数字段名表,下标即编码,只能在末尾追加
+    static const char* const keyTable[];
+    static const int KeyCount;
+
+    //不在表中时返回 -1
+    static int keyIndex(const QString& key);
+private:
+    static void writeObject_(QCborStreamWriter& writer, const QJsonObject& object);
+    static void writeValue_(QCborStreamWriter& writer, const QJsonValue& value);
+    static bool readObject_(const QCborValue& value, QJsonObject& object, QString& error);
+    static bool readValue_(const QCborValue& value, QJsonValue& ret, QString& error);
+};
+
+}
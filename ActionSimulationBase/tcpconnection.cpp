@@ -29,21 +29,69 @@ SOFTWARE.
 #include "datapackage.h"
 #include "commonfunction.h"
 
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define TCPCONNECTION_ZEROCOPY
+#endif
+#endif
+
 using namespace std;
 using namespace boost;
 using namespace boost::asio;
 
 namespace Jimmy
 {
-static uint64_t connection_index = 0;
+static std::atomic<uint64_t> connection_index{0};
+
+static void fillLengthPrefix(uint8_t* header, size_t dataLength)
+{
+    uint32_t length = static_cast<uint32_t>(dataLength);
+    header[0] = static_cast<uint8_t>(length >> 24);
+    header[1] = static_cast<uint8_t>(length >> 16);
+    header[2] = static_cast<uint8_t>(length >> 8);
+    header[3] = static_cast<uint8_t>(length);
+}
 
 TcpConnection::TcpConnection(TcpServer* pserver, boost::asio::io_context& ic)
     :server_(pserver)
     , connectionID_(++connection_index)
+    , ioContext_(ic)
+    , isLocal_(false)
+    , throttledMessages_(0)
+    , isThrottleKicked_(false)
+    , writeBufferBase_(0)
+    , writingBytes_(0)
+    , isZeroCopy_(false)
+    , isWaitingZeroCopy_(false)
+    , zeroCopySequence_(0)
+    , zeroCopyOffset_(0)
+    , isWriting_(false)
+    , queueBytes_(0)
+    , droppedMessages_(0)
+    , droppedBytes_(0)
+    , resyncTimes_(0)
+    , conflatedMessages_(0)
+    , isResyncPending_(false)
+    , isOverflowClosed_(false)
+    , writeTimer_(ic)
+    , timerWheel_(pserver->ioContextPool_->getTimerWheel(ic))
+    , startTick_(0)
+    , lastActivity_(0)
+    , isLogin_(false)
 {
-    connection_ = std::make_shared<boost::asio::ip::tcp::socket>(ic);
+    connection_ = std::make_shared<boost::asio::generic::stream_protocol::socket>(ic);
+
+    dataPackage_ = make_unique<DataPackage>(connectionID_);
+    dataPackage_->registerMessageProcessFunction([this](size_t, const std::string& message)
+    {
+        processMessage_(message);
+    });
 
-    memset(read_buffer_, 0, CommonConst::TCPBufferLength);
+    ingressBucket_.reset(server_->option_.ingressRate, server_->option_.ingressBurst);
 }
 
 TcpConnection::~TcpConnection()
@@ -71,11 +119,46 @@ void TcpConnection::disconnect()
     connection_->close(ec);
 }
 
+void TcpConnection::resolveRemote()
+{
+    boost::system::error_code ec;
+    auto remote = connection_->remote_endpoint(ec);
+    int family = remote.protocol().family();
+    if ((family == AF_INET) || (family == AF_INET6))
+    {
+        boost::asio::ip::tcp::endpoint tcpEndpoint;
+        memcpy(tcpEndpoint.data(), remote.data(), remote.size());
+        tcpEndpoint.resize(remote.size());
+
+        remoteAddress_ = tcpEndpoint.address();
+        clientInfo_ = QStringLiteral("%1:%2")
+            .arg(remoteAddress_.to_string().c_str())
+            .arg(tcpEndpoint.port());
+    }
+    else
+    {
+        //本机套接字的对端通常没有名字,用监听路径标识
+        isLocal_ = true;
+        clientInfo_ = QStringLiteral("unix:%1").arg(server_->option_.unixSocketPath.c_str());
+    }
+}
+
 void TcpConnection::start()
 {
-	clientInfo_ = QStringLiteral("%1:%2")
-		.arg(connection_->remote_endpoint().address().to_string().c_str())
-		.arg(connection_->remote_endpoint().port());
+    //可读时再用非阻塞方式读取,空闲连接不占用读缓冲区
+    boost::system::error_code ec;
+    connection_->non_blocking(true, ec);
+
+    if ((server_->option_.zeroCopyThreshold > 0) && (!isLocal_))
+    {
+        enableZeroCopy();
+    }
+
+    //start 在 accept 的线程上调用,时间轮必须在连接自己的 io 线程上访问
+    if ((server_->option_.idleTimeout > 0) || (server_->option_.loginTimeout > 0))
+    {
+        asio::post(connection_->get_executor(), bind(&TcpConnection::startTimeout, shared_from_this()));
+    }
 
     readData();
 }
@@ -92,51 +175,148 @@ void TcpConnection::readData()
         return;
     }
 
-    connection_->async_read_some(asio::buffer(read_buffer_, CommonConst::TCPBufferLength),
-        bind(&TcpConnection::handleRead, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+    connection_->async_wait(socket_base::wait_read,
+        makeCustomAllocHandler(readHandlerMemory_, [self = shared_from_this()](const boost::system::error_code& ec)
+        {
+            self->handleRead(ec);
+        }));
 }
 
-void TcpConnection::handleRead(const boost::system::error_code& ec, size_t bytes_transferred)
+void TcpConnection::handleRead(const boost::system::error_code& error)
 {
-    if (ec)
+    //同一 io 线程上的连接共用一个读缓冲区,数据在返回前已经组包或复制到 DataPackage
+    thread_local uint8_t readBuffer[CommonConst::TCPBufferLength];
+
+    boost::system::error_code ec = error;
+    size_t bytes_transferred(0);
+    for (size_t reads = 0; !ec; ++reads)
     {
-        if (ec != boost::asio::error::eof)
+        if (reads == MaxReadsPerWakeup)
         {
-            LOGERROR(QStringLiteral("[%1:%2][%3]connectionId[%4] read error.error code = %5 message = %6")
-                     .arg(__FUNCTION__)
-                     .arg(__LINE__)
-                     .arg(clientInfo_)
-                     .arg(connectionID_)
-                     .arg(ec.value())
-                     .arg(QString::fromLocal8Bit(CommonFunction::GBKtoUTF8(ec.message()).c_str())));
+            readData();
+            return;
+        }
 
-            disconnect();
+        bytes_transferred = connection_->read_some(asio::buffer(readBuffer, CommonConst::TCPBufferLength), ec);
+        if (ec == asio::error::would_block)
+        {
+            readData();
+            return;
         }
 
-        server_->removeConnection(connectionID_);
-        return;
+        if (ec || (bytes_transferred == 0))
+        {
+            break;
+        }
+
+        if (!processReadData_(readBuffer, bytes_transferred))
+        {
+            return;
+        }
+
+        //未读满说明接收缓冲区已空,重新等待可读
+        if (bytes_transferred < CommonConst::TCPBufferLength)
+        {
+            readData();
+            return;
+        }
     }
 
-    if (bytes_transferred > 0)
+    if (ec && (ec != boost::asio::error::eof))
     {
-        server_->dataPackage_->pushData(connectionID_, &read_buffer_[0], bytes_transferred);
+        LOGERROR(QStringLiteral("[%1:%2][%3]connectionId[%4] read error.error code = %5 message = %6")
+                 .arg(__FUNCTION__)
+                 .arg(__LINE__)
+                 .arg(clientInfo_)
+                 .arg(connectionID_)
+                 .arg(ec.value())
+                 .arg(QString::fromLocal8Bit(CommonFunction::GBKtoUTF8(ec.message()).c_str())));
+
+        disconnect();
+    }
+
+    server_->removeConnection(connectionID_);
+}
+
+bool TcpConnection::processReadData_(const uint8_t* pData, size_t bytes_transferred)
+{
+    lastActivity_ = timerWheel_.now();
 
-        QString readData = QString::fromLocal8Bit((const char*)read_buffer_, bytes_transferred);
+    QString readData = QString::fromLocal8Bit((const char*)pData, bytes_transferred);
 
-        LOGINFO(QStringLiteral("[%1:%2][%3]connectionId[%4] received (%5) message [%6]")
+    LOGINFO(QStringLiteral("[%1:%2][%3]connectionId[%4] received (%5) message [%6]")
+             .arg(__FUNCTION__)
+             .arg(__LINE__)
+             .arg(clientInfo_)
+             .arg(connectionID_)
+             .arg(bytes_transferred)
+             .arg(readData));
+
+    if (!dataPackage_->pushData(pData, bytes_transferred))
+    {
+        //无效数据超出缓冲区最大值，踢掉该连接
+        LOGERROR(QStringLiteral("[%1:%2][%3]connectionId[%4] incomplete message exceeds %5 bytes.")
                  .arg(__FUNCTION__)
                  .arg(__LINE__)
                  .arg(clientInfo_)
                  .arg(connectionID_)
-                 .arg(bytes_transferred)
-                 .arg(readData));
+                 .arg(CommonConst::JsonBagMaxLength));
 
-        connection_->async_read_some(asio::buffer(read_buffer_, CommonConst::TCPBufferLength),
-            bind(&TcpConnection::handleRead, shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+        disconnect();
+        return false;
     }
+
+    if (isThrottleKicked_)
+    {
+        LOGWARN(QStringLiteral("[%1:%2][%3]connectionId[%4] throttled %5 messages, kicked.")
+                 .arg(__FUNCTION__)
+                 .arg(__LINE__)
+                 .arg(clientInfo_)
+                 .arg(connectionID_)
+                 .arg(throttledMessages_.load()));
+
+        if ((!isLocal_) && (server_->option_.banTime > 0))
+        {
+            server_->banAddress_(remoteAddress_);
+        }
+
+        if (server_->blacklist_)
+        {
+            server_->blacklist_(connectionID_);
+        }
+
+        disconnect();
+        return false;
+    }
+
+    return true;
 }
 
-void TcpConnection::writeData(const QByteArray& data)
+void TcpConnection::processMessage_(const std::string& message)
+{
+    if (isThrottleKicked_)
+    {
+        return;
+    }
+
+    if (!ingressBucket_.consume())
+    {
+        auto throttled = ++throttledMessages_;
+        if ((server_->option_.ingressKickThreshold > 0) && (throttled >= server_->option_.ingressKickThreshold))
+        {
+            isThrottleKicked_ = true;
+        }
+
+        return;
+    }
+
+    if (server_->messageProcess_)
+    {
+        server_->messageProcess_(connectionID_, message);
+    }
+}
+
+void TcpConnection::writeData(const QByteArray& data, const QString& conflateKey)
 {
     if (!connection_->is_open())
     {
@@ -151,30 +331,278 @@ void TcpConnection::writeData(const QByteArray& data)
     if (!data.isEmpty())
     {
         lock_guard<mutex> lg(lockWriteBuffer_);
-        size_t write_queqe_length = writeBuffer_.size();
-        writeBuffer_.enqueue(data);
+        if (isOverflowClosed_)
+        {
+            return;
+        }
 
-        if (write_queqe_length == 0)
+        const TcpServerOption& option = server_->option_;
+        bool conflate = option.conflateOutput && (!conflateKey.isEmpty());
+        if (conflate)
         {
-            connection_->async_write_some(asio::buffer(writeBuffer_.front().data(), writeBuffer_.front().size()),
-                bind(&TcpConnection::handleWrite, shared_from_this(), std::placeholders::_1));
+            //同一 key 还有未发送的数据时直接替换,客户端只会收到最新值
+            auto itor = conflateIndex_.find(conflateKey);
+            if ((itor != conflateIndex_.end()) && (itor.value() >= writeBufferBase_))
+            {
+                auto& pending = writeBuffer_[static_cast<int>(itor.value() - writeBufferBase_)];
+                queueBytes_ = queueBytes_ - pending.data.size() + data.size();
+                pending.data = data;
+                ++conflatedMessages_;
+                return;
+            }
         }
-        else
+
+        size_t queueMessages = writeBuffer_.size() + writingBuffer_.size();
+        if ((option.writeQueueMaxMessages > 0) && (queueMessages >= option.writeQueueMaxMessages))
         {
-            if (write_queqe_length > WriteCacheMaxLength)
+            if (!applyOverflowPolicy_(option.messageOverflowPolicy, static_cast<size_t>(data.size())))
             {
-                LOGWARN(QStringLiteral("[%1:%2][%3]connectionId[%4] has %5 message waiting to send !")
+                return;
+            }
+        }
+
+        if ((option.writeQueueMaxBytes > 0) && (queueBytes_ + data.size() > option.writeQueueMaxBytes))
+        {
+            if (!applyOverflowPolicy_(option.byteOverflowPolicy, static_cast<size_t>(data.size())))
+            {
+                return;
+            }
+        }
+
+        if (conflate)
+        {
+            conflateIndex_.insert(conflateKey, writeBufferBase_ + writeBuffer_.size());
+        }
+
+        writeBuffer_.enqueue({data, conflateKey});
+        queueBytes_ += data.size();
+
+        if (!isWriting_)
+        {
+            //发送在连接所属的 io_context 线程上发起
+            isWriting_ = true;
+            asio::post(ioContext_.get_executor(), makeCustomAllocHandler(writeHandlerMemory_, bind(&TcpConnection::beginWrite, shared_from_this())));
+        }
+    }
+}
+
+//调用前需持有 lockWriteBuffer_,返回 false 表示丢弃当前数据
+bool TcpConnection::applyOverflowPolicy_(OverflowPolicy policy, size_t dataLength)
+{
+    switch (policy)
+    {
+    case OverflowPolicy::DropOldest:
+    {
+        if (dropOldest_(dataLength))
+        {
+            return true;
+        }
+
+        //剩下的都是正在发送的数据,仍然放不下时按字节上限的策略处理,该策略也是 DropOldest 时丢弃当前数据
+        const OverflowPolicy byteOverflowPolicy = server_->option_.byteOverflowPolicy;
+        if (byteOverflowPolicy != OverflowPolicy::DropOldest)
+        {
+            return applyOverflowPolicy_(byteOverflowPolicy, dataLength);
+        }
+
+        ++droppedMessages_;
+        droppedBytes_ += dataLength;
+        return false;
+    }
+    case OverflowPolicy::Resync:
+    {
+        //积压的数据已经过时,丢弃后由上层发送完整状态
+        dropAll_();
+        ++droppedMessages_;
+        droppedBytes_ += dataLength;
+
+        if (!isResyncPending_)
+        {
+            isResyncPending_ = true;
+            ++resyncTimes_;
+
+            LOGWARN(QStringLiteral("[%1:%2][%3]connectionId[%4] write queue overflow, request resync. dropped messages = %5")
                     .arg(__FUNCTION__)
                     .arg(__LINE__)
                     .arg(clientInfo_)
                     .arg(connectionID_)
-                    .arg(write_queqe_length));
-            }
+                    .arg(droppedMessages_));
+
+            asio::post(connection_->get_executor(), [self = shared_from_this()]()
+            {
+                {
+                    lock_guard<mutex> lg(self->lockWriteBuffer_);
+                    self->isResyncPending_ = false;
+                }
+
+                if (self->server_->resync_)
+                {
+                    self->server_->resync_(self->connectionID_);
+                }
+            });
+        }
+        return false;
+    }
+    case OverflowPolicy::Disconnect:
+    default:
+    {
+        LOGWARN(QStringLiteral("[%1:%2][%3]connectionId[%4] write queue overflow, disconnect. queue messages = %5, queue bytes = %6")
+                .arg(__FUNCTION__)
+                .arg(__LINE__)
+                .arg(clientInfo_)
+                .arg(connectionID_)
+                .arg(writeBuffer_.size() + writingBuffer_.size())
+                .arg(queueBytes_));
+
+        dropAll_();
+        ++droppedMessages_;
+        droppedBytes_ += dataLength;
+        isOverflowClosed_ = true;
+
+        //此时持有 lockWriteBuffer_,断开操作必须异步执行
+        asio::post(connection_->get_executor(), bind(&TcpConnection::disconnect, shared_from_this()));
+        return false;
+    }
+    }
+}
+
+//调用前需持有 lockWriteBuffer_,正在发送的数据不能丢弃,返回 false 表示丢弃后仍然放不下当前数据
+bool TcpConnection::dropOldest_(size_t dataLength)
+{
+    const TcpServerOption& option = server_->option_;
+    auto isFit = [&]()
+    {
+        bool messageFit = (option.writeQueueMaxMessages == 0) || (writeBuffer_.size() + writingBuffer_.size() < option.writeQueueMaxMessages);
+        bool byteFit = (option.writeQueueMaxBytes == 0) || (queueBytes_ + dataLength <= option.writeQueueMaxBytes);
+        return messageFit && byteFit;
+    };
+
+    while (!writeBuffer_.empty() && !isFit())
+    {
+        size_t length = popWriteBuffer_().size();
+        queueBytes_ -= length;
+        ++droppedMessages_;
+        droppedBytes_ += length;
+    }
+
+    return isFit();
+}
+
+//调用前需持有 lockWriteBuffer_
+void TcpConnection::dropAll_()
+{
+    while (!writeBuffer_.empty())
+    {
+        size_t length = popWriteBuffer_().size();
+        queueBytes_ -= length;
+        ++droppedMessages_;
+        droppedBytes_ += length;
+    }
+    conflateIndex_.clear();
+}
+
+//调用前需持有 lockWriteBuffer_
+QByteArray TcpConnection::popWriteBuffer_()
+{
+    ++writeBufferBase_;
+    return writeBuffer_.dequeue().data;
+}
+
+void TcpConnection::beginWrite()
+{
+    size_t batchWindow = server_->option_.writeBatchWindow;
+    if (batchWindow == 0)
+    {
+        lock_guard<mutex> lg(lockWriteBuffer_);
+        startWrite_();
+        return;
+    }
+
+    //等待合并窗口内到达的其他数据一起发送
+    writeTimer_.expires_after(std::chrono::microseconds(batchWindow));
+    writeTimer_.async_wait(makeCustomAllocHandler(writeHandlerMemory_, [self = shared_from_this()](const boost::system::error_code&)
+    {
+        lock_guard<mutex> lg(self->lockWriteBuffer_);
+        self->startWrite_();
+    }));
+}
+
+//调用前需持有 lockWriteBuffer_
+void TcpConnection::startWrite_()
+{
+    if (writeBuffer_.empty())
+    {
+        isWriting_ = false;
+        return;
+    }
+
+    //startWrite_ 只在 io 线程上调用,可以直接读取组包器的分包方式
+    bool lengthPrefix = (dataPackage_->getFramingMode() == FramingMode::LengthPrefix);
+    size_t zeroCopyThreshold = isZeroCopy_ ? server_->option_.zeroCopyThreshold : 0;
+
+    writingBytes_ = 0;
+    if ((zeroCopyThreshold > 0) && (static_cast<size_t>(writeBuffer_.head().data.size()) >= zeroCopyThreshold))
+    {
+        //大数据单独零拷贝发送,sendmsg 不能在持有 lockWriteBuffer_ 时完成回调,投递到 io 线程执行
+        writingBuffer_.push_back(popWriteBuffer_());
+        writingBytes_ = writingBuffer_.back().size();
+        zeroCopyOffset_ = 0;
+
+        //每次发送使用新的长度头,上一次发送的长度头由 zeroCopyBuffers_ 持有到完成通知,不会被改写
+        QByteArray header;
+        if (lengthPrefix)
+        {
+            header.resize(CommonConst::LengthPrefixSize);
+            fillLengthPrefix(reinterpret_cast<uint8_t*>(header.data()), writingBytes_);
+        }
+        zeroCopyHeader_ = header;
+
+        asio::post(ioContext_.get_executor(), makeCustomAllocHandler(writeHandlerMemory_, bind(&TcpConnection::writeZeroCopy, shared_from_this())));
+        return;
+    }
+
+    //把等待发送的数据合并为一次 gather 写,遇到需要零拷贝的大数据时停止
+    if (lengthPrefix)
+    {
+        //先分配好全部长度头,避免扩容后 writeSequence_ 中的地址失效
+        writeHeaders_.resize(writeBuffer_.size() * CommonConst::LengthPrefixSize);
+    }
+
+    writingBuffer_.reserve(writeBuffer_.size());
+    writeSequence_.clear();
+    while (!writeBuffer_.empty())
+    {
+        if ((zeroCopyThreshold > 0) && (static_cast<size_t>(writeBuffer_.head().data.size()) >= zeroCopyThreshold))
+        {
+            break;
+        }
+
+        writingBuffer_.push_back(popWriteBuffer_());
+        const QByteArray& data = writingBuffer_.back();
+        if (lengthPrefix)
+        {
+            uint8_t* header = &writeHeaders_[(writingBuffer_.size() - 1) * CommonConst::LengthPrefixSize];
+            fillLengthPrefix(header, data.size());
+            writeSequence_.push_back(asio::buffer(header, CommonConst::LengthPrefixSize));
         }
+        writeSequence_.push_back(asio::buffer(data.constData(), data.size()));
+        writingBytes_ += data.size();
     }
+
+    //剩余数据在队列中的序号仍然有效,只有队列为空时才清空
+    if (writeBuffer_.empty())
+    {
+        conflateIndex_.clear();
+    }
+
+    asio::async_write(*connection_, BufferSequenceView(writeSequence_),
+        makeCustomAllocHandler(writeHandlerMemory_, [self = shared_from_this()](const boost::system::error_code& ec, std::size_t bytes_transferred)
+        {
+            self->handleWrite(ec, bytes_transferred);
+        }));
 }
 
-void TcpConnection::handleWrite(const boost::system::error_code& ec)
+void TcpConnection::handleWrite(const boost::system::error_code& ec, std::size_t bytes_transferred)
 {
     if (ec)
     {
@@ -192,25 +620,284 @@ void TcpConnection::handleWrite(const boost::system::error_code& ec)
 
     lock_guard<mutex> lg(lockWriteBuffer_);
 
-    QString writeData = QString::fromLocal8Bit(writeBuffer_.dequeue());
-
-    LOGINFO(QStringLiteral("[%1:%2] write [%3]connectionId[%4] message = %5")
+    LOGDEBUG(QStringLiteral("[%1:%2] write [%3]connectionId[%4] %5 message(s) %6 bytes")
              .arg(__FUNCTION__)
              .arg(__LINE__)
              .arg(clientInfo_)
              .arg(connectionID_)
-             .arg(writeData));
+             .arg(writingBuffer_.size())
+             .arg(bytes_transferred));
+
+    queueBytes_ -= writingBytes_;
+    writingBuffer_.clear();
+
+    //发送期间到达的数据已经自然合并,不再等待合并窗口
+    startWrite_();
+}
+
+void TcpConnection::setLogin()
+{
+    isLogin_ = true;
+}
 
+bool TcpConnection::isLengthPrefix()
+{
+    //分帧方式在收到第一个字节时确定,之后才会有消息交给上层
+    return dataPackage_->getFramingMode() == FramingMode::LengthPrefix;
+}
 
-    if (!writeBuffer_.empty())
+bool TcpConnection::isLocal()
+{
+    return isLocal_;
+}
+
+void TcpConnection::startTimeout()
+{
+    startTick_ = timerWheel_.now();
+    lastActivity_ = startTick_;
+
+    uint64_t deadline = onTimerWheel(startTick_);
+    if (deadline != 0)
     {
-        auto& data = writeBuffer_.head();
-        connection_->async_write_some(asio::buffer(data, data.size()),
-            bind(&TcpConnection::handleWrite, shared_from_this(), std::placeholders::_1));
+        timerWheel_.add(shared_from_this(), deadline);
     }
 }
 
-boost::asio::ip::tcp::socket& TcpConnection::socket()
+uint64_t TcpConnection::onTimerWheel(uint64_t now)
+{
+    if (!connection_->is_open())
+    {
+        return 0;
+    }
+
+    const TcpServerOption& option = server_->option_;
+    uint64_t deadline(0);
+
+    if ((option.loginTimeout > 0) && (!isLogin_))
+    {
+        deadline = startTick_ + option.loginTimeout;
+        if (deadline <= now)
+        {
+            LOGWARN(QStringLiteral("[%1:%2][%3]connectionId[%4] not logged in within %5 seconds, disconnect.")
+                    .arg(__FUNCTION__)
+                    .arg(__LINE__)
+                    .arg(clientInfo_)
+                    .arg(connectionID_)
+                    .arg(option.loginTimeout));
+
+            disconnect();
+            return 0;
+        }
+    }
+
+    if (option.idleTimeout > 0)
+    {
+        uint64_t idleDeadline = lastActivity_ + option.idleTimeout;
+        if (idleDeadline <= now)
+        {
+            LOGWARN(QStringLiteral("[%1:%2][%3]connectionId[%4] idle for %5 seconds, disconnect.")
+                    .arg(__FUNCTION__)
+                    .arg(__LINE__)
+                    .arg(clientInfo_)
+                    .arg(connectionID_)
+                    .arg(now - lastActivity_));
+
+            disconnect();
+            return 0;
+        }
+
+        deadline = (deadline == 0) ? idleDeadline : std::min(deadline, idleDeadline);
+    }
+
+    return deadline;
+}
+
+void TcpConnection::enableZeroCopy()
+{
+#ifdef TCPCONNECTION_ZEROCOPY
+    int one = 1;
+    if (::setsockopt(connection_->native_handle(), SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0)
+    {
+        isZeroCopy_ = true;
+        return;
+    }
+
+    LOGWARN(QStringLiteral("[%1:%2][%3]connectionId[%4] SO_ZEROCOPY is not supported, errno = %5")
+            .arg(__FUNCTION__)
+            .arg(__LINE__)
+            .arg(clientInfo_)
+            .arg(connectionID_)
+            .arg(errno));
+#endif
+}
+
+//在 io 线程上执行,发送 writingBuffer_ 中唯一的数据
+void TcpConnection::writeZeroCopy()
+{
+#ifdef TCPCONNECTION_ZEROCOPY
+    const QByteArray& data = writingBuffer_.front();
+    size_t headerLength = zeroCopyHeader_.size();
+    size_t totalLength = headerLength + data.size();
+
+    while (zeroCopyOffset_ < totalLength)
+    {
+        iovec iov[2];
+        size_t count(0);
+        size_t dataOffset(0);
+        if (zeroCopyOffset_ < headerLength)
+        {
+            iov[count].iov_base = const_cast<char*>(zeroCopyHeader_.constData()) + zeroCopyOffset_;
+            iov[count].iov_len = headerLength - zeroCopyOffset_;
+            ++count;
+        }
+        else
+        {
+            dataOffset = zeroCopyOffset_ - headerLength;
+        }
+
+        iov[count].iov_base = const_cast<char*>(data.constData()) + dataOffset;
+        iov[count].iov_len = data.size() - dataOffset;
+        ++count;
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+
+        ssize_t sent = ::sendmsg(connection_->native_handle(), &msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        if (sent >= 0)
+        {
+            //每次成功的零拷贝 sendmsg 对应一个通知序号
+            zeroCopyBuffers_.enqueue({ zeroCopySequence_++, zeroCopyHeader_, data });
+            zeroCopyOffset_ += sent;
+            continue;
+        }
+
+        if (errno == EINTR)
+        {
+            continue;
+        }
+
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        {
+            waitZeroCopyComplete();
+            connection_->async_wait(socket_base::wait_write, [self = shared_from_this()](const boost::system::error_code& ec)
+            {
+                if (ec)
+                {
+                    self->handleWrite(ec, 0);
+                    return;
+                }
+
+                self->writeZeroCopy();
+            });
+            return;
+        }
+
+        if (errno == ENOBUFS)
+        {
+            //超出 optmem 限制,剩余数据改为普通发送
+            writeSequence_.clear();
+            if (zeroCopyOffset_ < headerLength)
+            {
+                writeSequence_.push_back(asio::buffer(zeroCopyHeader_.constData() + zeroCopyOffset_, headerLength - zeroCopyOffset_));
+            }
+            writeSequence_.push_back(asio::buffer(data.constData() + dataOffset, data.size() - dataOffset));
+
+            waitZeroCopyComplete();
+            asio::async_write(*connection_, BufferSequenceView(writeSequence_),
+                makeCustomAllocHandler(writeHandlerMemory_, [self = shared_from_this()](const boost::system::error_code& ec, std::size_t bytes_transferred)
+                {
+                    self->handleWrite(ec, bytes_transferred);
+                }));
+            return;
+        }
+
+        handleWrite(boost::system::error_code(errno, boost::system::system_category()), 0);
+        return;
+    }
+
+    waitZeroCopyComplete();
+    handleWrite(boost::system::error_code(), totalLength);
+#endif
+}
+
+void TcpConnection::waitZeroCopyComplete()
+{
+#ifdef TCPCONNECTION_ZEROCOPY
+    if (isWaitingZeroCopy_ || zeroCopyBuffers_.empty())
+    {
+        return;
+    }
+
+    //完成通知放在套接字的错误队列中
+    isWaitingZeroCopy_ = true;
+    connection_->async_wait(socket_base::wait_error, [self = shared_from_this()](const boost::system::error_code& ec)
+    {
+        self->handleZeroCopyComplete(ec);
+    });
+#endif
+}
+
+void TcpConnection::handleZeroCopyComplete(const boost::system::error_code& ec)
+{
+#ifdef TCPCONNECTION_ZEROCOPY
+    isWaitingZeroCopy_ = false;
+    if (ec)
+    {
+        //套接字已关闭,内核不会再发送这些数据
+        zeroCopyBuffers_.clear();
+        return;
+    }
+
+    for (;;)
+    {
+        char control[128];
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (::recvmsg(connection_->native_handle(), &msg, MSG_ERRQUEUE) < 0)
+        {
+            break;
+        }
+
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            bool isRecvErr = ((cm->cmsg_level == SOL_IP) && (cm->cmsg_type == IP_RECVERR))
+                || ((cm->cmsg_level == SOL_IPV6) && (cm->cmsg_type == IPV6_RECVERR));
+            if (!isRecvErr)
+            {
+                continue;
+            }
+
+            const sock_extended_err* serr = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cm));
+            if ((serr->ee_errno != 0) || (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY))
+            {
+                continue;
+            }
+
+            //通知中的 [ee_info, ee_data] 为已完成的序号范围
+            uint32_t first = serr->ee_info;
+            uint32_t range = serr->ee_data - first;
+            for (auto itor = zeroCopyBuffers_.begin(); itor != zeroCopyBuffers_.end();)
+            {
+                if ((itor->sequence - first) <= range)
+                {
+                    itor = zeroCopyBuffers_.erase(itor);
+                }
+                else
+                {
+                    ++itor;
+                }
+            }
+        }
+    }
+
+    waitZeroCopyComplete();
+#endif
+}
+
+boost::asio::generic::stream_protocol::socket& TcpConnection::socket()
 {
     return *connection_;
 }
@@ -220,4 +907,32 @@ QString TcpConnection::getClientInfo()
     return clientInfo_;
 }
 
+bool TcpConnection::getRemoteAddress(boost::asio::ip::address& address)
+{
+    if (isLocal_)
+    {
+        return false;
+    }
+
+    address = remoteAddress_;
+    return true;
+}
+
+ConnectionStatus TcpConnection::getStatus()
+{
+    ConnectionStatus status;
+    status.connectionId = connectionID_;
+    status.clientInfo = clientInfo_;
+
+    lock_guard<mutex> lg(lockWriteBuffer_);
+    status.queueMessages = writeBuffer_.size() + writingBuffer_.size();
+    status.queueBytes = queueBytes_;
+    status.droppedMessages = droppedMessages_;
+    status.droppedBytes = droppedBytes_;
+    status.resyncTimes = resyncTimes_;
+    status.conflatedMessages = conflatedMessages_;
+    status.throttledMessages = throttledMessages_;
+    return status;
+}
+
 }
@@ -30,46 +30,171 @@ SOFTWARE.
 #include <QString>
 #include <QByteArray>
 #include <QQueue>
+#include <QHash>
 #include "commonconst.h"
+#include "handlerallocator.h"
+#include "timerwheel.h"
+#include "tokenbucket.h"
 
 namespace Jimmy
 {
 
 class TcpServer;
+class DataPackage;
+struct ConnectionStatus;
+enum class OverflowPolicy;
 
-class TcpConnection final : public std::enable_shared_from_this<TcpConnection>
+class TcpConnection final : public std::enable_shared_from_this<TcpConnection>, public TimerWheel::Handler
 {
     Q_DISABLE_COPY(TcpConnection)
 public:
+    //读只有 wait_read(约 128 字节),写最大的是带 write_op 的 send_op(约 472 字节),按实际大小取整
+    using ReadHandlerMemory = HandlerMemory<256>;
+    using WriteHandlerMemory = HandlerMemory<512>;
+
     TcpConnection(TcpServer* pserver, boost::asio::io_context& ic);
     ~TcpConnection();
 
     size_t connectionID();
     void disconnect();
 
+    //accept 后加入连接表之前调用,解析对端地址
+    void resolveRemote();
     void start();
 
     void readData();
-    void writeData(const QByteArray& data);
 
-    boost::asio::ip::tcp::socket& socket();
+    //conflateKey 不为空且开启合并时,同一 key 尚未发送的旧数据会被新数据替换
+    void writeData(const QByteArray& data, const QString& conflateKey = QString());
+
+    boost::asio::generic::stream_protocol::socket& socket();
     QString getClientInfo();
+
+    //对端的 IP 地址,AF_UNIX 连接返回 false
+    bool getRemoteAddress(boost::asio::ip::address& address);
+
+    ConnectionStatus getStatus();
+
+    //登录成功后不再检查登录超时,可在任意线程调用
+    void setLogin();
+
+    //连接是否使用长度前缀分帧,二进制编码的消息只能在该模式下发送
+    bool isLengthPrefix();
+
+    //是否为 AF_UNIX 连接
+    bool isLocal();
+
+    uint64_t onTimerWheel(uint64_t now) override;
 private:
-    void handleRead(const boost::system::error_code& ec, std::size_t bytes_transferred);
-    void handleWrite(const boost::system::error_code& ec);
+    void startTimeout();
+
+    void handleRead(const boost::system::error_code& error);
+    bool processReadData_(const uint8_t* pData, size_t bytes_transferred);
+    void processMessage_(const std::string& message);
+
+    void beginWrite();
+    void startWrite_();
+    void handleWrite(const boost::system::error_code& ec, std::size_t bytes_transferred);
+
+    //MSG_ZEROCOPY 发送,仅 Linux 有效
+    void enableZeroCopy();
+    void writeZeroCopy();
+    void waitZeroCopyComplete();
+    void handleZeroCopyComplete(const boost::system::error_code& ec);
+
+    bool applyOverflowPolicy_(OverflowPolicy policy, size_t dataLength);
+    bool dropOldest_(size_t dataLength);
+    void dropAll_();
+    QByteArray popWriteBuffer_();
 private:
+    //一次可读通知最多读取的次数,数据持续到达时让出线程给同一 io_context 上的其他连接
+    static const size_t MaxReadsPerWakeup = 16;
+
     TcpServer* server_;
     const size_t connectionID_;
+    //发起写的 post 走 io_context 自身的执行器,socket 的 any_io_executor 不使用 handler 的分配器
+    boost::asio::io_context& ioContext_;
+
+    std::shared_ptr<boost::asio::generic::stream_protocol::socket> connection_;
+    bool isLocal_;                                              //AF_UNIX 连接
+
+    //读和写(含发起写的 post 和写合并计时器)各自最多只有一个未完成的异步操作,完成函数的内存循环使用
+    ReadHandlerMemory readHandlerMemory_;
+    WriteHandlerMemory writeHandlerMemory_;
+
+    std::unique_ptr<DataPackage> dataPackage_;                  //组包在读数据的 io 线程上完成
+
+    //接收限流同样在 io 线程上完成,超出速率的消息不再交给上层
+    TokenBucket ingressBucket_;
+    std::atomic<size_t> throttledMessages_;
+    bool isThrottleKicked_;
+
+    struct WriteData
+    {
+        QByteArray data;
+        QString conflateKey;
+    };
+
+    QQueue<WriteData> writeBuffer_;                             //等待发送的数据
+    uint64_t writeBufferBase_;                                  //writeBuffer_ 队首数据的序号
+    QHash<QString, uint64_t> conflateIndex_;                    //conflateKey -> 等待发送数据的序号
+    std::vector<QByteArray> writingBuffer_;                     //正在发送的数据,发送完成前不能释放
+    std::vector<boost::asio::const_buffer> writeSequence_;
+
+    //async_write 保存缓冲区序列的副本,传入 writeSequence_ 的视图只复制两个指针,发送完成前 writeSequence_ 不能修改
+    class BufferSequenceView
+    {
+    public:
+        explicit BufferSequenceView(const std::vector<boost::asio::const_buffer>& buffers)
+            :begin_(buffers.data())
+            , end_(buffers.data() + buffers.size())
+        {
+        }
+
+        const boost::asio::const_buffer* begin() const { return begin_; }
+        const boost::asio::const_buffer* end() const { return end_; }
+    private:
+        const boost::asio::const_buffer* begin_;
+        const boost::asio::const_buffer* end_;
+    };
+    std::vector<uint8_t> writeHeaders_;                         //LengthPrefix 模式下每个数据包的长度头
+    size_t writingBytes_;                                       //正在发送的数据字节数(不含长度头)
+
+    //零拷贝发送期间内核直接引用数据,收到完成通知前不能释放
+    struct ZeroCopyData
+    {
+        uint32_t sequence;
+        QByteArray header;
+        QByteArray data;
+    };
+
+    bool isZeroCopy_;                                           //套接字已开启 SO_ZEROCOPY
+    bool isWaitingZeroCopy_;                                    //正在等待错误队列中的完成通知
+    uint32_t zeroCopySequence_;                                 //下一次零拷贝 sendmsg 的通知序号
+    size_t zeroCopyOffset_;                                     //正在零拷贝发送的数据已发送的字节数
+    QByteArray zeroCopyHeader_;                                 //正在零拷贝发送的长度头,只读,与 zeroCopyBuffers_ 共享数据
+    QQueue<ZeroCopyData> zeroCopyBuffers_;
+    bool isWriting_;
+    std::mutex lockWriteBuffer_;
 
-    std::shared_ptr<boost::asio::ip::tcp::socket> connection_;
-
-    uint8_t read_buffer_[CommonConst::TCPBufferLength];
+    size_t queueBytes_;                                         //待发送(含正在发送)的字节数
+    size_t droppedMessages_;
+    size_t droppedBytes_;
+    size_t resyncTimes_;
+    size_t conflatedMessages_;
+    bool isResyncPending_;
+    bool isOverflowClosed_;
 
-    static const size_t WriteCacheMaxLength = 64;
-    QQueue<QByteArray> writeBuffer_;
-    std::mutex lockWriteBuffer_;
+    boost::asio::steady_timer writeTimer_;                      //写合并窗口计时器
 
     QString clientInfo_;
+    boost::asio::ip::address remoteAddress_;
+
+    //以下超时状态只在 io 线程上访问,时间单位为时间轮的 tick(秒)
+    TimerWheel& timerWheel_;
+    uint64_t startTick_;
+    uint64_t lastActivity_;                                     //最后一次收到数据的时间
+    std::atomic_bool isLogin_;
 };
 
 };
@@ -27,27 +27,33 @@ SOFTWARE.
 #include "tcpconnection.h"
 #include "logger.h"
 #include <boost/asio/socket_base.hpp>
-#include "datapackage.h"
 #include "commonfunction.h"
+#include <cstring>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
+#endif
 
 using namespace std;
 
 namespace Jimmy
 {
 
-TcpServer::TcpServer()
+TcpServer::TcpServer(const TcpServerOption& option)
     :isRun_(false)
+    , option_(option)
+    , isLocalBound_(false)
 {
-    dataPackage_ = make_shared<DataPackage>();
-    ioContextPool_ = make_shared<IoContextPool>();
+    ioContextPool_ = make_shared<IoContextPool>(option_.ioContextCount);
 }
 
 TcpServer::~TcpServer()
 {
-    isRun_ = false;
-    acceptor_->close();
+    //连接析构时会调用 removeConnection,必须在成员释放前断开
+    stop();
     ioContextPool_->stop();
-    dataPackage_.reset();
 }
 
 void TcpServer::registerAppendConnnection(std::function<Jimmy::User(size_t)> connection)
@@ -62,7 +68,17 @@ void TcpServer::registerRemoveConnnection(std::function<void(size_t)> connection
 
 void TcpServer::registerMessageProcessFunction(std::function<void(size_t, const std::string&)> messageProcess)
 {
-    dataPackage_->registerMessageProcessFunction(messageProcess);
+    messageProcess_ = messageProcess;
+}
+
+void TcpServer::registerResyncFunction(std::function<void(size_t)> resync)
+{
+    resync_ = resync;
+}
+
+void TcpServer::registerBlacklistFunction(std::function<void(size_t)> blacklist)
+{
+    blacklist_ = blacklist;
 }
 
 bool TcpServer::start(const boost::asio::ip::tcp::endpoint& endpoint)
@@ -71,41 +87,82 @@ bool TcpServer::start(const boost::asio::ip::tcp::endpoint& endpoint)
     {
         endPoints_ = endpoint;
 
-        acceptor_ = std::make_shared<boost::asio::ip::tcp::acceptor>(ioContextPool_->getIoContext());
-        acceptor_->open(endPoints_.protocol());
-        if (setOption() != ec_ok)
+        size_t acceptorCount = (option_.acceptorCount == 0) ? 1 : option_.acceptorCount;
+#ifndef SO_REUSEPORT
+        if (acceptorCount > 1)
         {
-            return isRun_;
+            LOGWARN(QStringLiteral("[%1:%2] SO_REUSEPORT is not supported,only one acceptor will be used")
+                     .arg(__FUNCTION__)
+                     .arg(__LINE__));
+            acceptorCount = 1;
         }
+#endif
 
-        boost::system::error_code ec;
-        acceptor_->bind(endPoints_, ec);
-        if (ec.failed())
+        for (size_t i = 0; i < acceptorCount; ++i)
         {
-            LOGERROR(QStringLiteral("[%1:%2] bind endpoint error,value = %3, message=%4")
-                     .arg(__FUNCTION__)
-                     .arg(__LINE__)
-                     .arg(ec.value())
-                     .arg(CommonFunction::GBKtoUTF8(ec.message()).c_str()));
-            return isRun_;
+            //每个监听器绑定到不同的 io_context,accept 由多个线程并行完成
+            auto acceptor = std::make_shared<stream_acceptor>(ioContextPool_->getIoContext(i));
+            acceptor->open(boost::asio::generic::stream_protocol(endPoints_.protocol()));
+            acceptors_.push_back(acceptor);
+
+            if (setOption(acceptor) != ec_ok)
+            {
+                closeAcceptors();
+                return isRun_;
+            }
+
+            boost::system::error_code ec;
+            acceptor->bind(boost::asio::generic::stream_protocol::endpoint(endPoints_), ec);
+            if (ec.failed())
+            {
+                LOGERROR(QStringLiteral("[%1:%2] bind endpoint error,value = %3, message=%4")
+                         .arg(__FUNCTION__)
+                         .arg(__LINE__)
+                         .arg(ec.value())
+                         .arg(CommonFunction::GBKtoUTF8(ec.message()).c_str()));
+                closeAcceptors();
+                return isRun_;
+            }
+
+            //端口为 0 时由系统分配,其余监听器使用同一个端口
+            if (endPoints_.port() == 0)
+            {
+                auto localEndpoint = acceptor->local_endpoint(ec);
+                if (!ec.failed())
+                {
+                    boost::asio::ip::tcp::endpoint boundEndpoint;
+                    std::memcpy(boundEndpoint.data(), localEndpoint.data(), localEndpoint.size());
+                    endPoints_.port(boundEndpoint.port());
+                }
+            }
+
+            acceptor->listen(MaxConcurrencyConnectionCount, ec);
+            if (ec.failed())
+            {
+                LOGERROR(QStringLiteral("[%1:%2] bind endpoint error,value = %3, message=%4")
+                         .arg(__FUNCTION__)
+                         .arg(__LINE__)
+                         .arg(ec.value())
+                         .arg(CommonFunction::GBKtoUTF8(ec.message()).c_str()));
+                closeAcceptors();
+                return isRun_;
+            }
         }
 
-        acceptor_->listen(MaxConcurrencyConnectionCount, ec);
-        if (ec.failed())
+        if ((!option_.unixSocketPath.empty()) && (!startLocal()))
         {
-            LOGERROR(QStringLiteral("[%1:%2] bind endpoint error,value = %3, message=%4")
-                     .arg(__FUNCTION__)
-                     .arg(__LINE__)
-                     .arg(ec.value())
-                     .arg(CommonFunction::GBKtoUTF8(ec.message()).c_str()));
+            closeAcceptors();
             return isRun_;
         }
-        else
+
+        LOGINFO(QStringLiteral("TcpServer Start listening,acceptor count = %1, io context count = %2")
+                .arg(acceptors_.size())
+                .arg(ioContextPool_->size()));
+
+        foreach (auto acceptor, acceptors_)
         {
-            LOGINFO("TcpServer Start listening");
+            startAccept(acceptor);
         }
-
-        startAccept();
         isRun_ = true;
     }
     ioContextPool_->run();
@@ -114,23 +171,48 @@ bool TcpServer::start(const boost::asio::ip::tcp::endpoint& endpoint)
 
 void TcpServer::stop()
 {
+    //再次 start 时重新监听,AF_UNIX 套接字文件在 closeAcceptors 中删除
+    isRun_ = false;
+    closeAcceptors();
     ioContextPool_->pause();
 
-    lock_guard<mutex> lg(lockConnections_);
-    foreach (auto item,connections_.values())
+    //disconnect 会调用 removeConnection,不能在持有分片锁时调用
+    foreach (auto item, getConnections_())
     {
         item->disconnect();
     }
-    connections_.clear();
+
+    for (auto& shard : connectionShards_)
+    {
+        lock_guard<shared_mutex> lg(shard.lock);
+        shard.connections.clear();
+    }
+}
+
+void TcpServer::closeAcceptors()
+{
+    boost::system::error_code ec;
+    foreach (auto acceptor, acceptors_)
+    {
+        acceptor->close(ec);
+    }
+    acceptors_.clear();
+
+    if (isLocalBound_)
+    {
+        isLocalBound_ = false;
+        removeLocalSocket();
+    }
 }
 
-void TcpServer::startAccept()
+void TcpServer::startAccept(acceptor_ptr acceptor)
 {
-    newConnection_.reset(new TcpConnection(this, ioContextPool_->getIoContext()));
-    acceptor_->async_accept(newConnection_->socket(), bind(&TcpServer::handleAccept, this, std::placeholders::_1));
+    //新连接按轮询分配到 io_context,读写在该 io_context 的线程上完成
+    std::shared_ptr<TcpConnection> newConnection(new TcpConnection(this, ioContextPool_->getIoContext()));
+    acceptor->async_accept(newConnection->socket(), bind(&TcpServer::handleAccept, this, acceptor, newConnection, std::placeholders::_1));
 }
 
-void TcpServer::handleAccept(const boost::system::error_code& ec)
+void TcpServer::handleAccept(acceptor_ptr acceptor, std::shared_ptr<TcpConnection> newConnection, const boost::system::error_code& ec)
 {
     if (ec)
     {
@@ -139,63 +221,286 @@ void TcpServer::handleAccept(const boost::system::error_code& ec)
                  .arg(__LINE__)
                  .arg(ec.value())
                  .arg(CommonFunction::GBKtoUTF8(ec.message()).c_str()));
+
+        if ((ec != boost::asio::error::operation_aborted) && acceptor->is_open())
+        {
+            startAccept(acceptor);
+        }
+        return;
+    }
+
+    newConnection->resolveRemote();
+
+    boost::asio::ip::address address;
+    if (newConnection->getRemoteAddress(address) && isBanned_(address))
+    {
+        LOGWARN(QStringLiteral("[%1:%2] connection %3 request from banned remote ip [%4] was refused")
+                 .arg(__FUNCTION__)
+                 .arg(__LINE__)
+                 .arg(newConnection->connectionID())
+                 .arg(newConnection->getClientInfo()));
+
+        boost::system::error_code closeError;
+        newConnection->socket().close(closeError);
+        startAccept(acceptor);
         return;
     }
 
     LOGINFO(QStringLiteral("[%1:%2] connection %3 request from remote ip [%4] was Accepted")
              .arg(__FUNCTION__)
              .arg(__LINE__)
-             .arg(newConnection_->connectionID())
-             .arg(newConnection_->getClientInfo()));
+             .arg(newConnection->connectionID())
+             .arg(newConnection->getClientInfo()));
 
-    appendConnection(newConnection_);
-    newConnection_->start();
-    startAccept();
+    appendConnection(newConnection);
+    newConnection->start();
+    startAccept(acceptor);
 }
 
 void TcpServer::appendConnection(std::shared_ptr<TcpConnection> pCon)
 {
-    lock_guard<mutex> lg(lockConnections_);
-    connections_.insert(pCon->connectionID(), pCon);
+    {
+        auto& shard = getShard_(pCon->connectionID());
+        lock_guard<shared_mutex> lg(shard.lock);
+        shard.connections.insert(pCon->connectionID(), pCon);
+    }
+
+    //回调中会加 UserManager 的锁,在分片锁外调用
     if (appendConnect_)
     {
         appendConnect_(pCon->connectionID());
-    } 
+    }
 }
 
 
 void TcpServer::removeConnection(size_t connectionId)
 {
+    bool removed(false);
+    {
+        auto& shard = getShard_(connectionId);
+        lock_guard<shared_mutex> lg(shard.lock);
+        removed = (shard.connections.remove(connectionId) > 0);
+    }
+
+    if (removed && removeConnect_)
+    {
+        removeConnect_(connectionId);
+    }
+}
+
+std::shared_ptr<TcpConnection> TcpServer::findConnection_(size_t connectionId)
+{
+    auto& shard = getShard_(connectionId);
+    shared_lock<shared_mutex> lg(shard.lock);
+    return shard.connections.value(connectionId);
+}
+
+QVector<std::shared_ptr<TcpConnection>> TcpServer::getConnections_()
+{
+    QVector<std::shared_ptr<TcpConnection>> vRet;
+    for (auto& shard : connectionShards_)
+    {
+        shared_lock<shared_mutex> lg(shard.lock);
+        foreach (auto item, shard.connections)
+        {
+            vRet.push_back(item);
+        }
+    }
+
+    return vRet;
+}
+
+void TcpServer::sendData(size_t connectionId, const QByteArray& data, const QString& conflateKey)
+{
+    auto pConnection = findConnection_(connectionId);
+    if (pConnection)
+    {
+        pConnection->writeData(data, conflateKey);
+    }
+}
+
+void TcpServer::sendData(const QVector<size_t>& connectionIds, const QByteArray& data, const QString& conflateKey)
+{
+    //按分片分组,每个分片只加一次读锁
+    std::array<QVector<size_t>, ConnectionShardCount> shardIds;
+    foreach (auto connectionId, connectionIds)
+    {
+        shardIds[connectionId % ConnectionShardCount].push_back(connectionId);
+    }
+
+    QVector<std::shared_ptr<TcpConnection>> vConnection;
+    vConnection.reserve(connectionIds.size());
+    for (size_t i = 0; i < ConnectionShardCount; ++i)
     {
-        lock_guard<mutex> lg(lockConnections_);
-        auto conn = connections_.find(connectionId);
-        if (conn != connections_.end())
+        if (shardIds[i].isEmpty())
         {
-            connections_.remove(connectionId);
-            if (removeConnect_)
+            continue;
+        }
+
+        auto& shard = connectionShards_[i];
+        shared_lock<shared_mutex> lg(shard.lock);
+        foreach (auto connectionId, shardIds[i])
+        {
+            auto itor = shard.connections.find(connectionId);
+            if (itor != shard.connections.end())
             {
-                removeConnect_(connectionId);
+                vConnection.push_back(itor.value());
             }
         }
     }
 
-    dataPackage_->pushData(connectionId, nullptr, 0);
+    foreach (auto item, vConnection)
+    {
+        item->writeData(data, conflateKey);
+    }
+}
+
+void TcpServer::setLogin(size_t connectionId)
+{
+    auto pConnection = findConnection_(connectionId);
+    if (pConnection)
+    {
+        pConnection->setLogin();
+    }
+}
+
+bool TcpServer::isLengthPrefix(size_t connectionId)
+{
+    auto pConnection = findConnection_(connectionId);
+    return pConnection && pConnection->isLengthPrefix();
+}
+
+bool TcpServer::getRemoteAddress(size_t connectionId, boost::asio::ip::address& address)
+{
+    auto pConnection = findConnection_(connectionId);
+    return pConnection && pConnection->getRemoteAddress(address);
+}
+
+bool TcpServer::isLocal(size_t connectionId)
+{
+    auto pConnection = findConnection_(connectionId);
+    return pConnection && pConnection->isLocal();
+}
+
+void TcpServer::banAddress_(const boost::asio::ip::address& address)
+{
+    auto now = chrono::steady_clock::now();
+
+    lock_guard<mutex> lg(lockBanned_);
+    //只在加入时清理过期的地址,被禁止的地址很少
+    for (auto itor = bannedAddresses_.begin(); itor != bannedAddresses_.end();)
+    {
+        itor = (itor->second <= now) ? bannedAddresses_.erase(itor) : std::next(itor);
+    }
+
+    bannedAddresses_[address] = now + chrono::seconds(option_.banTime);
+}
+
+bool TcpServer::isBanned_(const boost::asio::ip::address& address)
+{
+    lock_guard<mutex> lg(lockBanned_);
+    auto itor = bannedAddresses_.find(address);
+    if (itor == bannedAddresses_.end())
+    {
+        return false;
+    }
+
+    if (itor->second <= chrono::steady_clock::now())
+    {
+        bannedAddresses_.erase(itor);
+        return false;
+    }
+
+    return true;
+}
+
+QVector<ConnectionStatus> TcpServer::getConnectionStatus()
+{
+    QVector<ConnectionStatus> vRet;
+    foreach (auto item, getConnections_())
+    {
+        vRet.push_back(item->getStatus());
+    }
+
+    return vRet;
 }
 
-void TcpServer::sendData(size_t connectionId, const QByteArray& data)
+bool TcpServer::removeLocalSocket()
 {
-    lock_guard<mutex> lg(lockConnections_);
-    auto pT = connections_.find(connectionId);
-    if (pT != connections_.end())
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    struct stat fileStatus;
+    if (::lstat(option_.unixSocketPath.c_str(), &fileStatus) != 0)
     {
-        pT.value()->writeData(data);
+        return errno == ENOENT;
     }
+
+    //只删除套接字文件,配置错误时不能误删普通文件
+    if (!S_ISSOCK(fileStatus.st_mode))
+    {
+        LOGERROR(QStringLiteral("[%1:%2] %3 exists and is not a unix socket")
+                 .arg(__FUNCTION__)
+                 .arg(__LINE__)
+                 .arg(option_.unixSocketPath.c_str()));
+        return false;
+    }
+
+    return ::unlink(option_.unixSocketPath.c_str()) == 0;
+#else
+    return true;
+#endif
 }
 
-int TcpServer::setOption()
+bool TcpServer::startLocal()
 {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    //上次运行残留的套接字文件会导致 bind 失败
+    if (!removeLocalSocket())
+    {
+        return false;
+    }
+
+    boost::asio::local::stream_protocol::endpoint localEndpoint(option_.unixSocketPath);
+    auto acceptor = std::make_shared<stream_acceptor>(ioContextPool_->getIoContext(0));
+    acceptors_.push_back(acceptor);
+
     boost::system::error_code ec;
-    acceptor_->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true), ec);
+    acceptor->open(boost::asio::generic::stream_protocol(boost::asio::local::stream_protocol()), ec);
+    if (!ec)
+    {
+        acceptor->bind(boost::asio::generic::stream_protocol::endpoint(localEndpoint), ec);
+    }
+
+    if (!ec)
+    {
+        acceptor->listen(MaxConcurrencyConnectionCount, ec);
+    }
+
+    if (ec.failed())
+    {
+        LOGERROR(QStringLiteral("[%1:%2] listen unix socket %3 error,value = %4, message=%5")
+                 .arg(__FUNCTION__)
+                 .arg(__LINE__)
+                 .arg(option_.unixSocketPath.c_str())
+                 .arg(ec.value())
+                 .arg(CommonFunction::GBKtoUTF8(ec.message()).c_str()));
+        return false;
+    }
+
+    isLocalBound_ = true;
+    LOGINFO(QStringLiteral("TcpServer Start listening unix socket %1").arg(option_.unixSocketPath.c_str()));
+    return true;
+#else
+    LOGERROR(QStringLiteral("[%1:%2] unix socket is not supported on this platform")
+             .arg(__FUNCTION__)
+             .arg(__LINE__));
+    return false;
+#endif
+}
+
+int TcpServer::setOption(acceptor_ptr acceptor)
+{
+    boost::system::error_code ec;
+    acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true), ec);
     if (ec.failed())
     {
         LOGERROR(QStringLiteral("[%1:%2] set reuse_address error,value = %3, message=%4")
@@ -207,7 +512,25 @@ int TcpServer::setOption()
         return ErrorCode::ec_error;
     }
 
-    acceptor_->set_option(boost::asio::ip::tcp::no_delay(true), ec);
+#ifdef SO_REUSEPORT
+    if (option_.acceptorCount > 1)
+    {
+        using reuse_port = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+        acceptor->set_option(reuse_port(true), ec);
+        if (ec.failed())
+        {
+            LOGERROR(QStringLiteral("[%1:%2] set reuse_port error,value = %3, message=%4")
+                     .arg(__FUNCTION__)
+                     .arg(__LINE__)
+                     .arg(ec.value())
+                     .arg(CommonFunction::GBKtoUTF8(ec.message()).c_str()));
+
+            return ErrorCode::ec_error;
+        }
+    }
+#endif
+
+    acceptor->set_option(boost::asio::ip::tcp::no_delay(true), ec);
     if (ec.failed())
     {
         LOGERROR(QStringLiteral("[%1:%2] set no_delay error,value = %3, message=%4")
@@ -219,7 +542,7 @@ int TcpServer::setOption()
         return ErrorCode::ec_error;
     }
 
-    acceptor_->set_option(boost::asio::socket_base::keep_alive(true), ec);
+    acceptor->set_option(boost::asio::socket_base::keep_alive(true), ec);
     if (ec.failed())
     {
         LOGERROR(QStringLiteral("[%1:%2] set keep_alive error,value = %3, message=%4")
@@ -231,7 +554,7 @@ int TcpServer::setOption()
         return ErrorCode::ec_error;
     }
 
-    acceptor_->non_blocking(true, ec);
+    acceptor->non_blocking(true, ec);
     if (ec.failed())
     {
         LOGERROR(QStringLiteral("[%1:%2] set non_blocking error,value = %3, message=%4")
@@ -244,7 +567,7 @@ int TcpServer::setOption()
     }
 
     boost::asio::socket_base::receive_buffer_size receive_buffer(CommonConst::TCPBufferLength);
-    acceptor_->set_option(receive_buffer, ec);
+    acceptor->set_option(receive_buffer, ec);
     if (ec.failed())
     {
         LOGERROR(QStringLiteral("[%1:%2] set receive buffer error,value = %3, message=%4")
@@ -257,7 +580,7 @@ int TcpServer::setOption()
     }
 
     boost::asio::socket_base::send_buffer_size send_buffer(CommonConst::TCPBufferLength);
-    acceptor_->set_option(send_buffer, ec);
+    acceptor->set_option(send_buffer, ec);
     if (ec.failed())
     {
         LOGERROR(QStringLiteral("[%1:%2] set send buffer error,value = %3, message=%4")
@@ -25,7 +25,12 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 ******************************************************************************/
 #include <atomic>
+#include <array>
+#include <chrono>
+#include <map>
 #include <mutex>
+#include <shared_mutex>
+#include <string>
 #include <QHash>
 #include <QVector>
 #include <QSet>
@@ -35,25 +40,97 @@ SOFTWARE.
 namespace Jimmy
 {
 class TcpConnection;
-class DataPackage;
+
+//发送队列超出限制时的处理方式
+enum class OverflowPolicy
+{
+    Disconnect,                                 //断开连接
+    DropOldest,                                 //丢弃最早的待发送数据
+    Resync,                                     //丢弃所有待发送数据,由上层重新发送完整状态
+};
+
+struct TcpServerOption
+{
+    size_t ioContextCount{1};                   //io_context 数量(每个 io_context 一个线程),0 表示与 CPU 核数相同
+    size_t acceptorCount{1};                    //监听器数量,大于 1 时使用 SO_REUSEPORT 分布到不同 io_context 上
+    size_t writeBatchWindow{0};                 //写合并窗口(微秒),空闲连接收到第一条数据后等待该时间再一次性发送,0 表示立即发送
+
+    size_t writeQueueMaxMessages{4096};         //每个连接待发送消息数上限,0 表示不限制
+    OverflowPolicy messageOverflowPolicy{OverflowPolicy::Resync};
+    size_t writeQueueMaxBytes{64 * 1024 * 1024};//每个连接待发送字节数上限,0 表示不限制
+    OverflowPolicy byteOverflowPolicy{OverflowPolicy::Disconnect};
+
+    bool conflateOutput{false};                 //开启后同一 conflateKey 只发送最新的数据
+
+    size_t zeroCopyThreshold{0};                //不小于该字节数的数据使用 MSG_ZEROCOPY 发送(仅 Linux),0 表示不使用
+
+    std::string unixSocketPath;                 //不为空时在该路径上同时监听 AF_UNIX 流套接字,供本机客户端使用
+
+    size_t idleTimeout{0};                      //连接超过该秒数没有收到数据时断开,0 表示不检查
+    size_t loginTimeout{0};                     //连接后超过该秒数仍未登录时断开,0 表示不检查
+
+    size_t ingressRate{0};                      //每个连接每秒最多接收的消息数,超出的消息在 io 线程上丢弃,0 表示不限制
+    size_t ingressBurst{0};                     //每个连接允许的突发消息数,0 表示与 ingressRate 相同
+    size_t ingressKickThreshold{0};             //连接被丢弃的消息累计达到该值时断开并调用黑名单函数,0 表示只丢弃不断开
+    size_t banTime{0};                          //连接因超出接收速率被断开后,该秒数内拒绝同一 IP 地址的新连接,0 表示只断开
+};
+
+//连接发送队列状态
+struct ConnectionStatus
+{
+    size_t connectionId{0};
+    QString clientInfo;
+    size_t queueMessages{0};                    //待发送(含正在发送)的消息数
+    size_t queueBytes{0};                       //待发送(含正在发送)的字节数
+    size_t droppedMessages{0};                  //因队列超限丢弃的消息数
+    size_t droppedBytes{0};                     //因队列超限丢弃的字节数
+    size_t resyncTimes{0};                      //因队列超限请求重新同步的次数
+    size_t conflatedMessages{0};                //被新数据替换而未发送的消息数
+    size_t throttledMessages{0};                //因超出接收速率被丢弃的消息数
+};
 
 class TcpServer
 {
     Q_DISABLE_COPY(TcpServer)
     friend class TcpConnection;
 public:
-    TcpServer();
+    TcpServer(const TcpServerOption& option = TcpServerOption());
     ~TcpServer();
 
     bool start(const boost::asio::ip::tcp::endpoint& endpoint);
     void stop();
 
+    //监听的端口,start 时端口为 0 则为系统分配的端口
+    unsigned short getPort() const { return endPoints_.port(); }
+
     void registerAppendConnnection(std::function<Jimmy::User(size_t)> connection);
     void registerRemoveConnnection(std::function<void(size_t)> connection);
 
     void registerMessageProcessFunction(std::function<void(size_t,const std::string&)> messageProcess);
 
-    void sendData(size_t connectionId, const QByteArray& data);
+    //发送队列超限且策略为 Resync 时调用,由上层向该连接重新发送完整状态
+    void registerResyncFunction(std::function<void(size_t)> resync);
+
+    //连接因超出接收速率被断开时调用
+    void registerBlacklistFunction(std::function<void(size_t)> blacklist);
+
+    void sendData(size_t connectionId, const QByteArray& data, const QString& conflateKey = QString());
+    //同一份数据发送到多个连接,QByteArray 隐式共享,各连接队列中不复制数据
+    void sendData(const QVector<size_t>& connectionIds, const QByteArray& data, const QString& conflateKey = QString());
+
+    QVector<ConnectionStatus> getConnectionStatus();
+
+    //连接登录成功,不再受 loginTimeout 限制
+    void setLogin(size_t connectionId);
+
+    //连接是否使用长度前缀分帧,连接不存在时返回 false
+    bool isLengthPrefix(size_t connectionId);
+
+    //连接对端的 IP 地址,连接不存在或为 AF_UNIX 连接时返回 false
+    bool getRemoteAddress(size_t connectionId, boost::asio::ip::address& address);
+
+    //是否为 AF_UNIX 连接,连接不存在时返回 false
+    bool isLocal(size_t connectionId);
 
     
     void removeConnection(size_t connectionId);
@@ -61,30 +138,56 @@ public:
 private:
     void appendConnection(std::shared_ptr<TcpConnection> pCon);
 
-    int setOption();
-    void startAccept();
-    void handleAccept(const boost::system::error_code& ec);
+    //TCP 与 AF_UNIX 连接共用 generic::stream_protocol 的套接字和监听器
+    using stream_acceptor = boost::asio::basic_socket_acceptor<boost::asio::generic::stream_protocol>;
+    using acceptor_ptr = std::shared_ptr<stream_acceptor>;
+
+    int setOption(acceptor_ptr acceptor);
+    bool startLocal();
+    bool removeLocalSocket();
+    void startAccept(acceptor_ptr acceptor);
+    void handleAccept(acceptor_ptr acceptor, std::shared_ptr<TcpConnection> newConnection, const boost::system::error_code& ec);
+    void closeAcceptors();
+
+    void banAddress_(const boost::asio::ip::address& address);
+    bool isBanned_(const boost::asio::ip::address& address);
 private:
     static const size_t MaxConcurrencyConnectionCount = 10000;			//最大并发连接数
-    static const size_t MaxConnectionTime = 10;
 
     std::atomic_bool isRun_;
 
-    std::shared_ptr<boost::asio::ip::tcp::acceptor> acceptor_;
+    TcpServerOption option_;
+
+    QVector<acceptor_ptr> acceptors_;
+    bool isLocalBound_;                         //AF_UNIX 套接字文件由本对象创建,关闭监听时删除
 
     boost::asio::ip::tcp::endpoint endPoints_;
 
     std::shared_ptr<IoContextPool>  ioContextPool_;
 
-    std::shared_ptr<TcpConnection> newConnection_;
+    //连接表按连接号分片,每片独立加读写锁,发送数据只在对应分片上加读锁
+    //每片独占缓存行,相邻分片的锁不会伪共享
+    struct alignas(64) ConnectionShard
+    {
+        QHash<size_t, std::shared_ptr<TcpConnection>> connections;
+        std::shared_mutex lock;
+    };
 
-    QHash<size_t, std::shared_ptr<TcpConnection>> connections_;
-    std::mutex lockConnections_;
+    static const size_t ConnectionShardCount = 64;
+    std::array<ConnectionShard, ConnectionShardCount> connectionShards_;
 
-    std::shared_ptr<DataPackage> dataPackage_;
+    ConnectionShard& getShard_(size_t connectionId) { return connectionShards_[connectionId % ConnectionShardCount]; }
+    std::shared_ptr<TcpConnection> findConnection_(size_t connectionId);
+    QVector<std::shared_ptr<TcpConnection>> getConnections_();
 
+    std::function<void(size_t, const std::string&)> messageProcess_;
     std::function<Jimmy::User(size_t)> appendConnect_;
     std::function<void(size_t)> removeConnect_;
+    std::function<void(size_t)> resync_;
+    std::function<void(size_t)> blacklist_;
+
+    std::mutex lockBanned_;
+    std::map<boost::asio::ip::address, std::chrono::steady_clock::time_point> bannedAddresses_;  //地址 -> 解除禁止的时间
 
 
 };
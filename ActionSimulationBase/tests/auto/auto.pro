@@ -0,0 +1,14 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    tst_databuffer \
+    tst_datapackage \
+    tst_flatjsonparser \
+    tst_jsonscanner \
+    tst_messagecodec \
+    tst_multicastpublisher \
+    tst_tcpconnection \
+    tst_tcpserver \
+    tst_timerwheel \
+    tst_tokenbucket \
+    tst_writerpreferringmutex
@@ -0,0 +1,103 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <vector>
+#include "databuffer.h"
+#include "commonconst.h"
+
+using namespace Jimmy;
+
+class tst_DataBuffer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void append();
+    void maxLength();
+    void clearSmall();
+    void clearLarge();
+};
+
+void tst_DataBuffer::append()
+{
+    DataBuffer buffer;
+    QCOMPARE(buffer.getDataLength(), size_t(0));
+    QVERIFY(buffer.appendData(nullptr, 0));
+
+    //超过当前容量时扩容,已有数据保持不变
+    std::vector<uint8_t> data(3000);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<uint8_t>(i);
+    }
+
+    for (size_t pos = 0; pos < data.size(); pos += 100)
+    {
+        QVERIFY(buffer.appendData(&data[pos], 100));
+    }
+
+    QCOMPARE(buffer.getDataLength(), data.size());
+    QVERIFY(std::equal(data.begin(), data.end(), buffer.getData()));
+}
+
+void tst_DataBuffer::maxLength()
+{
+    //超出上限时在复制数据前返回 false,已有数据保持不变
+    DataBuffer buffer;
+    std::vector<uint8_t> data(100, 'a');
+    QVERIFY(buffer.appendData(data.data(), data.size()));
+    QVERIFY(!buffer.appendData(data.data(), static_cast<size_t>(CommonConst::JsonBagMaxLength) - data.size() + 1));
+    QCOMPARE(buffer.getDataLength(), data.size());
+}
+
+void tst_DataBuffer::clearSmall()
+{
+    //不超过初始大小的缓冲区保留,下一个包不需要重新分配
+    DataBuffer buffer;
+    std::vector<uint8_t> data(512, 'a');
+    QVERIFY(buffer.appendData(data.data(), data.size()));
+    const uint8_t* storage = buffer.getData();
+
+    buffer.clear();
+    QCOMPARE(buffer.getDataLength(), size_t(0));
+    QVERIFY(buffer.appendData(data.data(), data.size()));
+    QCOMPARE(buffer.getData(), storage);
+}
+
+void tst_DataBuffer::clearLarge()
+{
+    //超过初始大小的缓冲区在 clear 时释放
+    DataBuffer buffer;
+    std::vector<uint8_t> data(4096, 'a');
+    QVERIFY(buffer.appendData(data.data(), data.size()));
+
+    buffer.clear();
+    QCOMPARE(buffer.getDataLength(), size_t(0));
+    QVERIFY(buffer.getData() == nullptr);
+}
+
+QTEST_APPLESS_MAIN(tst_DataBuffer)
+
+#include "tst_databuffer.moc"
@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+TARGET = tst_databuffer
+
+SOURCES += \
+    tst_databuffer.cpp
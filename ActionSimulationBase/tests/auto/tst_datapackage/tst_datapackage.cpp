@@ -0,0 +1,266 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <random>
+#include <string>
+#include <vector>
+#include "datapackage.h"
+#include "commonconst.h"
+
+using namespace Jimmy;
+
+class tst_DataPackage : public QObject
+{
+    Q_OBJECT
+private slots:
+    void braceSingleMessage();
+    void braceMultipleMessages();
+    void braceStructuralInString();
+    void braceSplitMessage();
+    void braceStrayQuotation();
+    void lengthPrefixMessages();
+    void lengthPrefixSplitHeader();
+    void lengthPrefixTooLong();
+    void braceChunked();
+    void lengthPrefixChunked();
+private:
+    static std::string lengthPrefix(const std::vector<std::string>& messages);
+    static std::vector<std::string> chunkMessages();
+    static void pushChunked(const std::string& stream, const std::vector<std::string>& expected);
+};
+
+//把 pushData 交出的消息收集到 messages 中
+static void collect(DataPackage& package, std::vector<std::string>& messages)
+{
+    package.registerMessageProcessFunction([&messages](size_t, const std::string& message)
+    {
+        messages.push_back(message);
+    });
+}
+
+static bool push(DataPackage& package, const std::string& data)
+{
+    return package.pushData(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+std::string tst_DataPackage::lengthPrefix(const std::vector<std::string>& messages)
+{
+    std::string data(1, static_cast<char>(CommonConst::LengthPrefixMagic));
+    for (auto& message : messages)
+    {
+        size_t length = message.size();
+        data.push_back(static_cast<char>((length >> 24) & 0xFF));
+        data.push_back(static_cast<char>((length >> 16) & 0xFF));
+        data.push_back(static_cast<char>((length >> 8) & 0xFF));
+        data.push_back(static_cast<char>(length & 0xFF));
+        data.append(message);
+    }
+
+    return data;
+}
+
+void tst_DataPackage::braceSingleMessage()
+{
+    DataPackage package(1);
+    std::vector<std::string> messages;
+    collect(package, messages);
+
+    QVERIFY(push(package, R"({"action":"heartbeat"})"));
+    QCOMPARE(package.getFramingMode(), FramingMode::Brace);
+    QCOMPARE(messages.size(), size_t(1));
+    QCOMPARE(messages[0], std::string(R"({"action":"heartbeat"})"));
+}
+
+void tst_DataPackage::braceMultipleMessages()
+{
+    DataPackage package(1);
+    std::vector<std::string> messages;
+    collect(package, messages);
+
+    //包之间的空白和换行被丢弃,嵌套对象属于同一个包
+    QVERIFY(push(package, "{\"a\":1}\r\n{\"b\":{\"c\":2}}  {\"d\":3}"));
+    QCOMPARE(messages.size(), size_t(3));
+    QCOMPARE(messages[0], std::string(R"({"a":1})"));
+    QCOMPARE(messages[1], std::string(R"({"b":{"c":2}})"));
+    QCOMPARE(messages[2], std::string(R"({"d":3})"));
+}
+
+void tst_DataPackage::braceStructuralInString()
+{
+    DataPackage package(1);
+    std::vector<std::string> messages;
+    collect(package, messages);
+
+    std::string message = R"({"a":"}{","b":"\"}","c":"\\"})";
+    QVERIFY(push(package, message));
+    QCOMPARE(messages.size(), size_t(1));
+    QCOMPARE(messages[0], message);
+}
+
+void tst_DataPackage::braceSplitMessage()
+{
+    DataPackage package(1);
+    std::vector<std::string> messages;
+    collect(package, messages);
+
+    QVERIFY(push(package, R"({"a":"x\)"));
+    QVERIFY(messages.empty());
+    QVERIFY(push(package, R"("}"}{"b")"));
+    QCOMPARE(messages.size(), size_t(1));
+    QCOMPARE(messages[0], std::string(R"({"a":"x\"}"})"));
+    QVERIFY(push(package, ":2}"));
+    QCOMPARE(messages.size(), size_t(2));
+    QCOMPARE(messages[1], std::string(R"({"b":2})"));
+}
+
+void tst_DataPackage::braceStrayQuotation()
+{
+    DataPackage package(1);
+    std::vector<std::string> messages;
+    collect(package, messages);
+
+    //包之间多余的引号不影响之后的包
+    QVERIFY(push(package, R"({"a":1}")"));
+    QVERIFY(push(package, R"( {"b":"}"} " {"c":2})"));
+    QVERIFY(push(package, R"({"d":3})"));
+    QCOMPARE(messages.size(), size_t(4));
+    QCOMPARE(messages[1], std::string(R"({"b":"}"})"));
+    QCOMPARE(messages[2], std::string(R"({"c":2})"));
+    QCOMPARE(messages[3], std::string(R"({"d":3})"));
+}
+
+void tst_DataPackage::lengthPrefixMessages()
+{
+    DataPackage package(1);
+    std::vector<std::string> messages;
+    collect(package, messages);
+
+    //长度为 0 的包不交给上层
+    QVERIFY(push(package, lengthPrefix({ R"({"a":1})", "", R"({"b":"}"})" })));
+    QCOMPARE(package.getFramingMode(), FramingMode::LengthPrefix);
+    QCOMPARE(messages.size(), size_t(2));
+    QCOMPARE(messages[0], std::string(R"({"a":1})"));
+    QCOMPARE(messages[1], std::string(R"({"b":"}"})"));
+}
+
+void tst_DataPackage::lengthPrefixSplitHeader()
+{
+    DataPackage package(1);
+    std::vector<std::string> messages;
+    collect(package, messages);
+
+    std::string data = lengthPrefix({ R"({"a":1})", R"({"b":2})" });
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        QVERIFY(push(package, data.substr(i, 1)));
+    }
+
+    QCOMPARE(messages.size(), size_t(2));
+    QCOMPARE(messages[0], std::string(R"({"a":1})"));
+    QCOMPARE(messages[1], std::string(R"({"b":2})"));
+}
+
+void tst_DataPackage::lengthPrefixTooLong()
+{
+    DataPackage package(1);
+    std::vector<std::string> messages;
+    collect(package, messages);
+
+    std::string data(1, static_cast<char>(CommonConst::LengthPrefixMagic));
+    data.append("\xFF\xFF\xFF\xFF", 4);
+    QVERIFY(!push(package, data));
+    QVERIFY(messages.empty());
+}
+
+//字符串中含有结构字符和转义字符,长度跨越扫描块的大小
+std::vector<std::string> tst_DataPackage::chunkMessages()
+{
+    return {
+        R"({"action":"heartbeat"})",
+        R"({"a":"}{","b":"\"}","c":"\\"})",
+        R"({"cid":"T1","value":{"x":[1,{"y":"\\\""}]}})",
+        R"({"s":")" + std::string(70, 'x') + R"(\"}{"})",
+        "{}",
+        u8R"({"name":"中文\"}"})",
+    };
+}
+
+//同一段数据按每个位置切成两段,再按随机长度切成多段,结果都应与原消息相同
+void tst_DataPackage::pushChunked(const std::string& stream, const std::vector<std::string>& expected)
+{
+    for (size_t split = 0; split <= stream.size(); ++split)
+    {
+        DataPackage package(1);
+        std::vector<std::string> messages;
+        collect(package, messages);
+
+        QVERIFY(push(package, stream.substr(0, split)));
+        QVERIFY(push(package, stream.substr(split)));
+        QCOMPARE(messages, expected);
+    }
+
+    std::mt19937 random(2022);
+    for (size_t maxChunk : { 1, 3, 7, 16, 33, 100 })
+    {
+        std::uniform_int_distribution<size_t> chunk(1, maxChunk);
+        for (int round = 0; round < 20; ++round)
+        {
+            DataPackage package(1);
+            std::vector<std::string> messages;
+            collect(package, messages);
+
+            for (size_t pos = 0; pos < stream.size();)
+            {
+                size_t length = std::min(chunk(random), stream.size() - pos);
+                QVERIFY(push(package, stream.substr(pos, length)));
+                pos += length;
+            }
+            QCOMPARE(messages, expected);
+        }
+    }
+}
+
+void tst_DataPackage::braceChunked()
+{
+    auto expected = chunkMessages();
+    std::string stream;
+    for (auto& message : expected)
+    {
+        stream.append(message).append("\r\n");
+    }
+
+    pushChunked(stream, expected);
+}
+
+void tst_DataPackage::lengthPrefixChunked()
+{
+    auto expected = chunkMessages();
+    pushChunked(lengthPrefix(expected), expected);
+}
+
+QTEST_APPLESS_MAIN(tst_DataPackage)
+
+#include "tst_datapackage.moc"
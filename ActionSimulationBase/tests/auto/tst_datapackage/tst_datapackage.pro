@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+TARGET = tst_datapackage
+
+SOURCES += \
+    tst_datapackage.cpp
@@ -0,0 +1,139 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include "flatjsonparser.h"
+
+using namespace Jimmy;
+
+class tst_FlatJsonParser : public QObject
+{
+    Q_OBJECT
+private slots:
+    void fields();
+    void emptyObject();
+    void values();
+    void fallback_data();
+    void fallback();
+};
+
+static bool parse(FlatJsonParser& parser, const QByteArray& data)
+{
+    return parser.parse(data.constData(), static_cast<size_t>(data.size()));
+}
+
+void tst_FlatJsonParser::fields()
+{
+    FlatJsonParser parser;
+    QVERIFY(parse(parser, " {\"action\" : \"update_value\", \"cid\":\"T1\",\r\n\"value\":-12.5e2 }\n"));
+
+    auto action = parser.find("action");
+    QVERIFY(action != nullptr);
+    QCOMPARE(action->type, QJsonValue::String);
+    QCOMPARE(FlatJsonParser::toString(*action), QStringLiteral("update_value"));
+
+    auto cid = parser.find("cid");
+    QVERIFY(cid != nullptr);
+    QCOMPARE(FlatJsonParser::toString(*cid), QStringLiteral("T1"));
+
+    auto value = parser.find("value");
+    QVERIFY(value != nullptr);
+    QCOMPARE(value->type, QJsonValue::Double);
+    QCOMPARE(FlatJsonParser::toValue(*value).toDouble(), -1250.0);
+
+    QVERIFY(parser.find("sid") == nullptr);
+}
+
+void tst_FlatJsonParser::emptyObject()
+{
+    FlatJsonParser parser;
+    QVERIFY(parse(parser, "{ }"));
+    QVERIFY(parser.find("action") == nullptr);
+
+    //上一次解析的字段不会残留
+    QVERIFY(parse(parser, R"({"a":1})"));
+    QVERIFY(parse(parser, "{}"));
+    QVERIFY(parser.find("a") == nullptr);
+}
+
+void tst_FlatJsonParser::values()
+{
+    FlatJsonParser parser;
+    QVERIFY(parse(parser, u8R"({"t":true,"f":false,"n":null,"i":0,"s":"中文","e":""})"));
+
+    QCOMPARE(FlatJsonParser::toValue(*parser.find("t")), QJsonValue(true));
+    QCOMPARE(FlatJsonParser::toValue(*parser.find("f")), QJsonValue(false));
+    QVERIFY(FlatJsonParser::toValue(*parser.find("n")).isNull());
+    QCOMPARE(FlatJsonParser::toValue(*parser.find("i")), QJsonValue(0.0));
+    QCOMPARE(FlatJsonParser::toValue(*parser.find("s")), QJsonValue(QString::fromUtf8(u8"中文")));
+    QCOMPARE(FlatJsonParser::toValue(*parser.find("e")), QJsonValue(QString()));
+
+    //四字节编码和 U+10FFFF 是合法的 UTF-8,double 的最大值是合法的数值
+    QVERIFY(parse(parser, "{\"s\":\"\xF0\x9F\x98\x80\",\"m\":\"\xF4\x8F\xBF\xBF\",\"d\":1.7976931348623157e308}"));
+    QCOMPARE(FlatJsonParser::toString(*parser.find("s")), QString::fromUtf8("\xF0\x9F\x98\x80"));
+    QCOMPARE(FlatJsonParser::toValue(*parser.find("d")).toDouble(), 1.7976931348623157e308);
+}
+
+void tst_FlatJsonParser::fallback_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    //以下情况由调用者改用 QJsonDocument
+    QTest::newRow("escape") << QByteArray(R"({"a":"x\"y"})");
+    QTest::newRow("object") << QByteArray(R"({"a":{"b":1}})");
+    QTest::newRow("array") << QByteArray(R"({"a":[1,2]})");
+    QTest::newRow("duplicate") << QByteArray(R"({"a":1,"a":2})");
+    QTest::newRow("too many fields") << QByteArray(R"({"a":1,"b":2,"c":3,"d":4,"e":5,"f":6,"g":7,"h":8,"i":9})");
+    QTest::newRow("control character") << QByteArray("{\"a\":\"x\ty\"}");
+    QTest::newRow("leading zero") << QByteArray(R"({"a":01})");
+    QTest::newRow("bad literal") << QByteArray(R"({"a":tru})");
+    QTest::newRow("trailing comma") << QByteArray(R"({"a":1,})");
+    QTest::newRow("trailing data") << QByteArray(R"({"a":1}x)");
+    QTest::newRow("unterminated") << QByteArray(R"({"a":"x)");
+    QTest::newRow("not object") << QByteArray(R"(["a"])");
+    QTest::newRow("overlong utf-8") << QByteArray("{\"a\":\"\xC0\xAF\"}");
+    QTest::newRow("overlong 3-byte utf-8") << QByteArray("{\"a\":\"\xE0\x80\xAF\"}");
+    QTest::newRow("surrogate") << QByteArray("{\"a\":\"\xED\xA0\x80\"}");
+    QTest::newRow("above U+10FFFF") << QByteArray("{\"a\":\"\xF4\x90\x80\x80\"}");
+    QTest::newRow("invalid lead byte") << QByteArray("{\"a\":\"\xF5\x80\x80\x80\"}");
+    QTest::newRow("lone continuation") << QByteArray("{\"a\":\"\x80\"}");
+    QTest::newRow("truncated utf-8") << QByteArray("{\"a\":\"\xE4\xB8\"}");
+    QTest::newRow("invalid utf-8 key") << QByteArray("{\"\xFF\":1}");
+    QTest::newRow("number overflow") << QByteArray(R"({"a":1e999})");
+    QTest::newRow("negative overflow") << QByteArray(R"({"a":-1e999})");
+    QTest::newRow("empty") << QByteArray();
+}
+
+void tst_FlatJsonParser::fallback()
+{
+    QFETCH(QByteArray, data);
+
+    FlatJsonParser parser;
+    QVERIFY(!parse(parser, data));
+}
+
+QTEST_APPLESS_MAIN(tst_FlatJsonParser)
+
+#include "tst_flatjsonparser.moc"
@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+TARGET = tst_flatjsonparser
+
+SOURCES += \
+    tst_flatjsonparser.cpp
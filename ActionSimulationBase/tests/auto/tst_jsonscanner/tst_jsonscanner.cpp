@@ -0,0 +1,118 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <random>
+#include <vector>
+#include "jsonscanner.h"
+
+using namespace Jimmy;
+
+class tst_JsonScanner : public QObject
+{
+    Q_OBJECT
+private slots:
+    void backend();
+    void emptyRange();
+    void everyPosition();
+    void randomData();
+};
+
+void tst_JsonScanner::backend()
+{
+    QByteArray name(JsonScanner::backendName());
+    QVERIFY(name == "avx2" || name == "sse2" || name == "scalar");
+}
+
+void tst_JsonScanner::emptyRange()
+{
+    const uint8_t data[] = { '{' };
+    QCOMPARE(JsonScanner::findStructural(data, 0, 0), size_t(0));
+    QCOMPARE(JsonScanner::findStructural(data, 1, 1), size_t(1));
+
+    //组包时跳过末尾的转义字符,起始位置可能超过 length
+    QCOMPARE(JsonScanner::findStructural(data, 2, 1), size_t(1));
+}
+
+void tst_JsonScanner::everyPosition()
+{
+    //单个结构字符出现在 16/32 字节块的每个位置,以及块尾不足一块的部分
+    const uint8_t structurals[] = { '{', '}', '"', '\\' };
+    for (uint8_t ch : structurals)
+    {
+        for (size_t length = 1; length <= 100; ++length)
+        {
+            std::vector<uint8_t> data(length, 'a');
+            for (size_t hit = 0; hit < length; ++hit)
+            {
+                data[hit] = ch;
+                for (size_t pos = 0; pos <= length; ++pos)
+                {
+                    size_t expected = (pos <= hit) ? hit : length;
+                    QCOMPARE(JsonScanner::findStructural(data.data(), pos, length), expected);
+                }
+                data[hit] = 'a';
+            }
+            QCOMPARE(JsonScanner::findStructural(data.data(), 0, length), length);
+        }
+    }
+}
+
+void tst_JsonScanner::randomData()
+{
+    std::mt19937 random(20221);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<int> sparse(0, 63);
+
+    for (int round = 0; round < 200; ++round)
+    {
+        std::vector<uint8_t> data(1 + round * 7);
+        for (auto& ch : data)
+        {
+            //大部分是普通字符,保证一次查找会跨越多个块,高位字节用来检查有符号比较
+            int value = byte(random);
+            if (sparse(random) == 0)
+            {
+                ch = static_cast<uint8_t>("{}\"\\"[value % 4]);
+            }
+            else
+            {
+                ch = static_cast<uint8_t>((value & 1) ? ('a' + value % 26) : (value | 0x80));
+            }
+        }
+
+        size_t pos(0);
+        while (pos < data.size())
+        {
+            size_t expected = JsonScanner::findStructuralScalar(data.data(), pos, data.size());
+            QCOMPARE(JsonScanner::findStructural(data.data(), pos, data.size()), expected);
+            pos = expected + 1;
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(tst_JsonScanner)
+
+#include "tst_jsonscanner.moc"
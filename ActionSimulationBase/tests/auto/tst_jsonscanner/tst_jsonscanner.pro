@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+TARGET = tst_jsonscanner
+
+SOURCES += \
+    tst_jsonscanner.cpp
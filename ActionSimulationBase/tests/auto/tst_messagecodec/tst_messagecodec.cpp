@@ -0,0 +1,154 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include "messagecodec.h"
+
+using namespace Jimmy;
+
+class tst_MessageCodec : public QObject
+{
+    Q_OBJECT
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void wellKnownKeys();
+    void utf8();
+    void numbers();
+    void isCbor();
+    void rejects_data();
+    void rejects();
+};
+
+static QJsonObject object(const char* json)
+{
+    return QJsonDocument::fromJson(json).object();
+}
+
+void tst_MessageCodec::roundTrip_data()
+{
+    QTest::addColumn<QByteArray>("json");
+
+    QTest::newRow("component change") << QByteArray(R"({"cid":"T1","value":25.5})");
+    QTest::newRow("handle change") << QByteArray(R"({"h":12,"v":-3,"sid":7})");
+    QTest::newRow("reply") << QByteArray(R"({"action":"login","result":"failed","reason":"user is not exist"})");
+    QTest::newRow("unknown keys") << QByteArray(R"({"component_type":"input","default_value":null,"x":true})");
+    QTest::newRow("nested") << QByteArray(R"({"action":"batch","changes":[{"cid":"T1","value":1},{"cid":"T2","value":[1,"a",false]}]})");
+    QTest::newRow("object value") << QByteArray(R"({"cid":"T1","value":{"value":{"cid":"inner"}}})");
+    QTest::newRow("chinese") << QByteArray(R"({"cid":"温度传感器","value":"状态:正常","名称":"一号"})");
+    QTest::newRow("large integer") << QByteArray(R"({"value":9007199254740992,"seq":-9007199254740992})");
+    QTest::newRow("fraction") << QByteArray(R"({"value":1e300,"v":-0.125})");
+    QTest::newRow("empty") << QByteArray("{}");
+}
+
+void tst_MessageCodec::roundTrip()
+{
+    QFETCH(QByteArray, json);
+
+    auto message = object(json.constData());
+    auto data = MessageCodec::toCbor(message);
+    QVERIFY(MessageCodec::isCbor(data.constData(), static_cast<size_t>(data.size())));
+
+    QJsonObject decoded;
+    QString error;
+    QVERIFY2(MessageCodec::fromCbor(data, decoded, error), qPrintable(error));
+    QCOMPARE(decoded, message);
+}
+
+void tst_MessageCodec::wellKnownKeys()
+{
+    //QJsonObject 按字段名排序,cid(1) 在 value(2) 之前
+    auto data = MessageCodec::toCbor(object(R"({"cid":"a","value":1})"));
+    QCOMPARE(data, QByteArray("\xA2\x01\x61\x61\x02\x01", 6));
+
+    //编码是协议的一部分,不能改变已有字段的位置
+    QCOMPARE(MessageCodec::keyIndex("action"), 0);
+    QCOMPARE(MessageCodec::keyIndex("sid"), 5);
+    QCOMPARE(MessageCodec::keyIndex("h"), 6);
+    QCOMPARE(MessageCodec::keyIndex("v"), 7);
+    QCOMPARE(MessageCodec::keyIndex("component_type"), -1);
+
+    //表中字段小于 24,编码为一个字节
+    QVERIFY(MessageCodec::KeyCount <= 24);
+    for (int i = 0; i < MessageCodec::KeyCount; ++i)
+    {
+        QCOMPARE(MessageCodec::keyIndex(MessageCodec::keyTable[i]), i);
+    }
+}
+
+void tst_MessageCodec::utf8()
+{
+    //字段名和字符串均为 UTF-8 文本,与系统的本地编码无关
+    auto data = MessageCodec::toCbor(object(R"({"名":"温度"})"));
+    QCOMPARE(data, QByteArray("\xA1\x63\xE5\x90\x8D\x66\xE6\xB8\xA9\xE5\xBA\xA6", 12));
+
+    QCOMPARE(MessageCodec::toJson(object(R"({"cid":"温度"})")), QByteArray(R"({"cid":"温度"})"));
+}
+
+void tst_MessageCodec::numbers()
+{
+    //整数值按整数编码,其余按 double 编码
+    QCOMPARE(MessageCodec::toCbor(object(R"({"v":3.0})")), QByteArray("\xA1\x07\x03", 3));
+    QCOMPARE(MessageCodec::toCbor(object(R"({"v":-500})")), QByteArray("\xA1\x07\x39\x01\xF3", 5));
+    QCOMPARE(MessageCodec::toCbor(object(R"({"v":1.5})")), QByteArray("\xA1\x07\xFB\x3F\xF8\x00\x00\x00\x00\x00\x00", 11));
+}
+
+void tst_MessageCodec::isCbor()
+{
+    QVERIFY(!MessageCodec::isCbor("", 0));
+    QVERIFY(!MessageCodec::isCbor("{}", 2));
+    QVERIFY(MessageCodec::isCbor("\xA0", 1));
+    QVERIFY(MessageCodec::isCbor("\xBF", 1));
+    QVERIFY(!MessageCodec::isCbor("\x80", 1));
+}
+
+void tst_MessageCodec::rejects_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("unknown integer key") << QByteArray("\xA1\x18\x64\x01", 4);
+    QTest::newRow("negative key") << QByteArray("\xA1\x20\x01", 3);
+    QTest::newRow("byte string key") << QByteArray("\xA1\x41\x61\x01", 4);
+    QTest::newRow("nested unknown key") << QByteArray("\xA1\x02\xA1\x17\x01", 5);
+    QTest::newRow("array") << QByteArray("\x81\x01", 2);
+    QTest::newRow("truncated") << QByteArray("\xA2\x01\x61", 3);
+    QTest::newRow("trailing data") << QByteArray("\xA1\x01\x01\xFF", 4);
+}
+
+void tst_MessageCodec::rejects()
+{
+    QFETCH(QByteArray, data);
+
+    QJsonObject message;
+    QString error;
+    QVERIFY(!MessageCodec::fromCbor(data, message, error));
+    QVERIFY(!error.isEmpty());
+}
+
+QTEST_APPLESS_MAIN(tst_MessageCodec)
+
+#include "tst_messagecodec.moc"
@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+TARGET = tst_messagecodec
+
+SOURCES += \
+    tst_messagecodec.cpp
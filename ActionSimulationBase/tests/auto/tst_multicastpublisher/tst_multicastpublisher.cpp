@@ -0,0 +1,244 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "multicastpublisher.h"
+
+using namespace Jimmy;
+
+//本机回环接口上加入组播组,接收 MulticastPublisher 发出的数据报
+class tst_MulticastPublisher : public QObject
+{
+    Q_OBJECT
+private slots:
+    void loopbackReceive();
+    void concurrentPublish();
+    void snapshot();
+};
+
+static const char* const GroupAddress = "239.255.0.1";
+
+//打开接收套接字并加入组播组,返回绑定的端口,系统不支持组播时返回 0
+static uint16_t openReceiver(boost::asio::ip::udp::socket& socket)
+{
+    boost::system::error_code ec;
+    socket.open(boost::asio::ip::udp::v4(), ec);
+    if (!ec)
+    {
+        socket.set_option(boost::asio::ip::udp::socket::reuse_address(true), ec);
+    }
+
+    if (!ec)
+    {
+        socket.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::any(), 0), ec);
+    }
+
+    if (!ec)
+    {
+        socket.set_option(boost::asio::ip::multicast::join_group(boost::asio::ip::make_address_v4(GroupAddress),
+                                                                 boost::asio::ip::address_v4::loopback()), ec);
+    }
+
+    return ec ? 0 : socket.local_endpoint().port();
+}
+
+//两秒内收到一个数据报则返回其内容,否则返回空
+static QByteArray receiveDatagram(boost::asio::io_context& ic, boost::asio::ip::udp::socket& socket)
+{
+    std::vector<char> buffer(65536);
+    size_t length(0);
+    bool received(false);
+    socket.async_receive(boost::asio::buffer(buffer), [&](const boost::system::error_code& ec, size_t bytes)
+    {
+        received = !ec;
+        length = bytes;
+    });
+
+    ic.restart();
+    ic.run_for(std::chrono::seconds(2));
+    if (!received)
+    {
+        socket.cancel();
+        ic.restart();
+        ic.run();
+        return QByteArray();
+    }
+
+    return QByteArray(buffer.data(), static_cast<int>(length));
+}
+
+static MulticastOption makeOption(uint16_t port)
+{
+    MulticastOption option;
+    option.enable = true;
+    option.address = GroupAddress;
+    option.port = port;
+    option.interfaceAddress = QStringLiteral("127.0.0.1");
+    option.loopback = true;
+    return option;
+}
+
+void tst_MulticastPublisher::loopbackReceive()
+{
+    boost::asio::io_context ic;
+    boost::asio::ip::udp::socket receiver(ic);
+    uint16_t port = openReceiver(receiver);
+    if (port == 0)
+    {
+        QSKIP("multicast is not available on the loopback interface");
+    }
+
+    MulticastPublisher publisher;
+    QVERIFY(publisher.start(makeOption(port)));
+
+    publisher.publish(User(1), QStringLiteral("T1"), QJsonValue(1));
+    publisher.publish(User(1), QStringLiteral("T2"), QJsonValue(QStringLiteral("on")));
+    publisher.publish(User(2), QStringLiteral("T1"), QJsonValue(3));
+
+    //序号按用户分别递增
+    struct Expected
+    {
+        int seq;
+        int userid;
+        const char* cid;
+        QJsonValue value;
+    };
+    const Expected expected[] = {
+        { 1, 1, "T1", QJsonValue(1) },
+        { 2, 1, "T2", QJsonValue(QStringLiteral("on")) },
+        { 1, 2, "T1", QJsonValue(3) },
+    };
+
+    for (const Expected& item : expected)
+    {
+        QByteArray datagram = receiveDatagram(ic, receiver);
+        QVERIFY(!datagram.isEmpty());
+
+        QJsonObject jo = QJsonDocument::fromJson(datagram).object();
+        QCOMPARE(jo.value("seq").toInt(), item.seq);
+        QCOMPARE(jo.value("userid").toInt(), item.userid);
+        QCOMPARE(jo.value("cid").toString(), QString(item.cid));
+        QCOMPARE(jo.value("value"), item.value);
+    }
+
+    publisher.stop();
+}
+
+void tst_MulticastPublisher::concurrentPublish()
+{
+    boost::asio::io_context ic;
+    boost::asio::ip::udp::socket receiver(ic);
+    uint16_t port = openReceiver(receiver);
+    if (port == 0)
+    {
+        QSKIP("multicast is not available on the loopback interface");
+    }
+
+    MulticastPublisher publisher;
+    QVERIFY(publisher.start(makeOption(port)));
+
+    //多个线程同时发布同一用户的值,序号不重复也不缺失,数据报按序号顺序发出
+    const int threadCount = 4;
+    const int publishCount = 25;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([&publisher, i]()
+        {
+            for (int j = 0; j < publishCount; ++j)
+            {
+                publisher.publish(User(1), QStringLiteral("T%1").arg(i), QJsonValue(j));
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (int i = 0; i < threadCount * publishCount; ++i)
+    {
+        QByteArray datagram = receiveDatagram(ic, receiver);
+        QVERIFY(!datagram.isEmpty());
+        QCOMPARE(QJsonDocument::fromJson(datagram).object().value("seq").toInt(), i + 1);
+    }
+
+    publisher.stop();
+}
+
+void tst_MulticastPublisher::snapshot()
+{
+    boost::asio::io_context ic;
+    boost::asio::ip::udp::socket receiver(ic);
+    uint16_t port = openReceiver(receiver);
+    if (port == 0)
+    {
+        QSKIP("multicast is not available on the loopback interface");
+    }
+
+    MulticastPublisher publisher;
+    QVERIFY(publisher.start(makeOption(port)));
+
+    publisher.publish(User(1), QStringLiteral("T1"), QJsonValue(1));
+    publisher.publish(User(1), QStringLiteral("T1"), QJsonValue(2));
+
+    //快照期间另一个线程发布同一用户的值,数据报要等快照结束后才发出
+    std::thread publishThread;
+    bool called(false);
+    uint64_t seq = publisher.snapshot(User(1), [&]()
+    {
+        called = true;
+        publishThread = std::thread([&publisher]()
+        {
+            publisher.publish(User(1), QStringLiteral("T1"), QJsonValue(3));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+    publishThread.join();
+
+    QVERIFY(called);
+    QCOMPARE(seq, uint64_t(2));
+    QCOMPARE(publisher.snapshot(User(2), []() {}), uint64_t(0));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        QByteArray datagram = receiveDatagram(ic, receiver);
+        QVERIFY(!datagram.isEmpty());
+        QCOMPARE(QJsonDocument::fromJson(datagram).object().value("seq").toInt(), i + 1);
+    }
+
+    publisher.stop();
+}
+
+QTEST_APPLESS_MAIN(tst_MulticastPublisher)
+
+#include "tst_multicastpublisher.moc"
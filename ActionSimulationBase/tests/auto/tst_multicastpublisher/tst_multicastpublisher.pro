@@ -0,0 +1,10 @@
+include(../../tests.pri)
+
+TARGET = tst_multicastpublisher
+
+# 被测模块在服务端工程中,只依赖基础库
+INCLUDEPATH += $$PWD/../../../../ActionSimulationServer
+
+SOURCES += \
+    tst_multicastpublisher.cpp \
+    $$PWD/../../../../ActionSimulationServer/multicastpublisher.cpp
@@ -0,0 +1,265 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include "tcpserver.h"
+#include "tcpconnection.h"
+#include "commonconst.h"
+
+using namespace Jimmy;
+
+//统计测试期间的堆分配,调用 sendData 的线程与 io 线程分别计数
+namespace
+{
+
+std::atomic_bool countAllocations(false);
+std::atomic<size_t> callerAllocations(0);
+std::atomic<size_t> ioAllocations(0);
+std::thread::id callerThread;
+
+}
+
+void* operator new(std::size_t size)
+{
+    if (countAllocations)
+    {
+        if (std::this_thread::get_id() == callerThread)
+        {
+            ++callerAllocations;
+        }
+        else
+        {
+            ++ioAllocations;
+        }
+    }
+
+    void* pointer = std::malloc((size == 0) ? 1 : size);
+    if (pointer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+class tst_TcpConnection : public QObject
+{
+    Q_OBJECT
+private slots:
+    void writeAllocations_data();
+    void writeAllocations();
+    void readAllocations();
+};
+
+void tst_TcpConnection::writeAllocations_data()
+{
+    QTest::addColumn<bool>("lengthPrefix");
+
+    QTest::newRow("brace") << false;
+    QTest::newRow("length prefix") << true;
+}
+
+void tst_TcpConnection::writeAllocations()
+{
+    QFETCH(bool, lengthPrefix);
+
+    TcpServer server;
+
+    std::mutex lockConnection;
+    std::condition_variable changed;
+    size_t connectionId(0);
+    size_t messageCount(0);
+    server.registerAppendConnnection([&](size_t id)
+    {
+        std::lock_guard<std::mutex> lg(lockConnection);
+        connectionId = id;
+        changed.notify_all();
+        return Jimmy::User(id);
+    });
+    server.registerMessageProcessFunction([&](size_t, const std::string&)
+    {
+        std::lock_guard<std::mutex> lg(lockConnection);
+        ++messageCount;
+        changed.notify_all();
+    });
+    QVERIFY(server.start(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)));
+
+    boost::asio::io_context ic;
+    boost::asio::ip::tcp::socket client(ic);
+    client.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), server.getPort()));
+
+    //先发送一条消息确定分帧方式
+    std::string hello(R"({"action":"heartbeat"})");
+    if (lengthPrefix)
+    {
+        std::string frame(1, static_cast<char>(CommonConst::LengthPrefixMagic));
+        frame.append(3, '\0').append(1, static_cast<char>(hello.size())).append(hello);
+        hello = frame;
+    }
+    boost::asio::write(client, boost::asio::buffer(hello));
+    {
+        std::unique_lock<std::mutex> lk(lockConnection);
+        QVERIFY(changed.wait_for(lk, std::chrono::seconds(10), [&]() { return (connectionId != 0) && (messageCount == 1); }));
+    }
+
+    const QByteArray message(R"({"action":"update_value","cid":"T1","value":1})");
+    const size_t replyLength = static_cast<size_t>(message.size()) + (lengthPrefix ? CommonConst::LengthPrefixSize : 0);
+    std::string reply(replyLength, '\0');
+    auto roundTrip = [&]()
+    {
+        server.sendData(connectionId, message);
+        boost::asio::read(client, boost::asio::buffer(&reply[0], reply.size()));
+    };
+
+    //预热后发送路径上的容器已经有足够的容量
+    for (int i = 0; i < 100; ++i)
+    {
+        roundTrip();
+    }
+
+    const size_t rounds = 200;
+    callerThread = std::this_thread::get_id();
+    callerAllocations = 0;
+    ioAllocations = 0;
+    countAllocations = true;
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        roundTrip();
+    }
+    countAllocations = false;
+
+    QCOMPARE(reply.substr(reply.size() - static_cast<size_t>(message.size())), std::string(message.constData()));
+
+    //io 线程上的 gather 写不分配内存,调用线程只有发送队列的节点
+    QCOMPARE(ioAllocations.load(), size_t(0));
+    QVERIFY2(callerAllocations <= rounds, QByteArray::number(static_cast<qulonglong>(callerAllocations.load())).constData());
+
+    client.close();
+    server.stop();
+}
+
+void tst_TcpConnection::readAllocations()
+{
+    //与 TcpConnection::readData 相同的等待方式:wait_read 完成后在 io 线程上 read_some 并重新等待
+    boost::asio::io_context ic;
+    boost::asio::local::stream_protocol::socket reader(ic);
+    boost::asio::local::stream_protocol::socket writer(ic);
+    boost::asio::local::connect_pair(reader, writer);
+    reader.non_blocking(true);
+
+    TcpConnection::ReadHandlerMemory memory;
+    std::mutex lockRead;
+    std::condition_variable changed;
+    size_t readCount(0);
+    char buffer[64];
+    //完成函数同 TcpConnection 一样持有一个 shared_ptr
+    auto owner = std::make_shared<int>(0);
+
+    std::function<void()> waitRead;
+    waitRead = [&]()
+    {
+        reader.async_wait(boost::asio::socket_base::wait_read,
+            makeCustomAllocHandler(memory, [&, self = owner](const boost::system::error_code& ec)
+            {
+                if (ec)
+                {
+                    return;
+                }
+
+                boost::system::error_code readError;
+                reader.read_some(boost::asio::buffer(buffer), readError);
+                {
+                    std::lock_guard<std::mutex> lg(lockRead);
+                    ++readCount;
+                    changed.notify_all();
+                }
+                waitRead();
+            }));
+    };
+
+    auto work = boost::asio::make_work_guard(ic);
+    std::thread ioThread([&]() { ic.run(); });
+
+    size_t expected(0);
+    auto roundTrip = [&]()
+    {
+        boost::asio::write(writer, boost::asio::buffer("x", 1));
+        ++expected;
+        std::unique_lock<std::mutex> lk(lockRead);
+        return changed.wait_for(lk, std::chrono::seconds(10), [&]() { return readCount == expected; });
+    };
+
+    boost::asio::post(ic, waitRead);
+    for (int i = 0; i < 100; ++i)
+    {
+        QVERIFY(roundTrip());
+    }
+
+    const size_t rounds = 200;
+    callerThread = std::this_thread::get_id();
+    callerAllocations = 0;
+    ioAllocations = 0;
+    countAllocations = true;
+    bool completed(true);
+    for (size_t i = 0; (i < rounds) && completed; ++i)
+    {
+        completed = roundTrip();
+    }
+    countAllocations = false;
+
+    reader.close();
+    work.reset();
+    ioThread.join();
+
+    QVERIFY(completed);
+
+    //每次可读通知的等待操作都复用读槽,io 线程不分配内存
+    QCOMPARE(ioAllocations.load(), size_t(0));
+}
+
+QTEST_APPLESS_MAIN(tst_TcpConnection)
+
+#include "tst_tcpconnection.moc"
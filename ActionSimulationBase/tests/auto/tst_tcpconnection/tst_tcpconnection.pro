@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+TARGET = tst_tcpconnection
+
+SOURCES += \
+    tst_tcpconnection.cpp
@@ -0,0 +1,313 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tcpserver.h"
+
+using namespace Jimmy;
+
+class tst_TcpServer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void ioThreads_data();
+    void ioThreads();
+    void dropOldestOversized();
+    void largeStream();
+    void localSocket();
+    void banKickedAddress();
+};
+
+static const boost::asio::ip::tcp::endpoint AnyLoopback(boost::asio::ip::address_v4::loopback(), 0);
+
+void tst_TcpServer::ioThreads_data()
+{
+    QTest::addColumn<int>("ioThreads");
+
+    QTest::newRow("1") << 1;
+    QTest::newRow("2") << 2;
+    QTest::newRow("4") << 4;
+}
+
+void tst_TcpServer::ioThreads()
+{
+    QFETCH(int, ioThreads);
+
+    //连接按轮询分配到各 io_context,每个 io 线程都应处理到消息
+    TcpServerOption option;
+    option.ioContextCount = static_cast<size_t>(ioThreads);
+    TcpServer server(option);
+
+    std::mutex lockThreads;
+    std::condition_variable received;
+    std::set<std::thread::id> threads;
+    size_t messageCount(0);
+    server.registerMessageProcessFunction([&](size_t, const std::string&)
+    {
+        std::lock_guard<std::mutex> lg(lockThreads);
+        threads.insert(std::this_thread::get_id());
+        ++messageCount;
+        received.notify_all();
+    });
+
+    QVERIFY(server.start(AnyLoopback));
+    QVERIFY(server.getPort() != 0);
+
+    const size_t clientCount = static_cast<size_t>(ioThreads) * 2;
+    boost::asio::io_context ic;
+    std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> clients;
+    for (size_t i = 0; i < clientCount; ++i)
+    {
+        clients.push_back(std::make_unique<boost::asio::ip::tcp::socket>(ic));
+        clients.back()->connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), server.getPort()));
+        boost::asio::write(*clients.back(), boost::asio::buffer(std::string(R"({"action":"heartbeat"})")));
+    }
+
+    {
+        std::unique_lock<std::mutex> lk(lockThreads);
+        QVERIFY(received.wait_for(lk, std::chrono::seconds(10), [&]() { return messageCount == clientCount; }));
+        QCOMPARE(threads.size(), static_cast<size_t>(ioThreads));
+        QVERIFY(threads.count(std::this_thread::get_id()) == 0);
+    }
+
+    clients.clear();
+    server.stop();
+}
+
+void tst_TcpServer::dropOldestOversized()
+{
+    //正在发送的数据不能丢弃,丢弃所有待发送数据后仍然放不下的消息不进入队列
+    TcpServerOption option;
+    option.writeQueueMaxBytes = 64;
+    option.byteOverflowPolicy = OverflowPolicy::DropOldest;
+    TcpServer server(option);
+
+    std::mutex lockConnection;
+    std::condition_variable accepted;
+    size_t connectionId(0);
+    server.registerAppendConnnection([&](size_t id)
+    {
+        std::lock_guard<std::mutex> lg(lockConnection);
+        connectionId = id;
+        accepted.notify_all();
+        return Jimmy::User(id);
+    });
+    QVERIFY(server.start(AnyLoopback));
+
+    boost::asio::io_context ic;
+    boost::asio::ip::tcp::socket client(ic);
+    client.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), server.getPort()));
+    {
+        std::unique_lock<std::mutex> lk(lockConnection);
+        QVERIFY(accepted.wait_for(lk, std::chrono::seconds(10), [&]() { return connectionId != 0; }));
+    }
+
+    const std::string small(R"({"action":"heartbeat"})");
+    server.sendData(connectionId, QByteArray(std::string(100, 'x').c_str()));
+    server.sendData(connectionId, QByteArray(small.c_str()));
+
+    std::string reply(small.size(), '\0');
+    boost::asio::read(client, boost::asio::buffer(&reply[0], reply.size()));
+    QCOMPARE(reply, small);
+
+    auto status = server.getConnectionStatus();
+    QCOMPARE(status.size(), 1);
+    QCOMPARE(status[0].droppedMessages, size_t(1));
+    QCOMPARE(status[0].droppedBytes, size_t(100));
+
+    client.close();
+    server.stop();
+}
+
+void tst_TcpServer::largeStream()
+{
+    //数据量远大于一次可读通知的读取上限,剩余数据在下一次通知中读取
+    TcpServer server;
+
+    std::mutex lockCount;
+    std::condition_variable received;
+    size_t messageCount(0);
+    size_t byteCount(0);
+    server.registerMessageProcessFunction([&](size_t, const std::string& message)
+    {
+        std::lock_guard<std::mutex> lg(lockCount);
+        ++messageCount;
+        byteCount += message.size();
+        received.notify_all();
+    });
+    QVERIFY(server.start(AnyLoopback));
+
+    const size_t messageTotal = 50000;
+    std::string payload;
+    for (size_t i = 0; i < messageTotal; ++i)
+    {
+        payload.append(R"({"action":"update_value","cid":"T1","value":)").append(std::to_string(i)).append("}");
+    }
+
+    boost::asio::io_context ic;
+    boost::asio::ip::tcp::socket client(ic);
+    client.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), server.getPort()));
+    boost::asio::write(client, boost::asio::buffer(payload));
+
+    {
+        std::unique_lock<std::mutex> lk(lockCount);
+        QVERIFY(received.wait_for(lk, std::chrono::seconds(30), [&]() { return messageCount == messageTotal; }));
+        QCOMPARE(byteCount, payload.size());
+    }
+
+    client.close();
+    server.stop();
+}
+
+void tst_TcpServer::localSocket()
+{
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    auto path = std::filesystem::temp_directory_path() / "tst_tcpserver.sock";
+    std::filesystem::remove(path);
+
+    TcpServerOption option;
+    option.unixSocketPath = path.string();
+
+    //路径被普通文件占用时不启动,也不删除该文件
+    std::ofstream(path.string()) << "data";
+    {
+        TcpServer server(option);
+        QVERIFY(!server.start(AnyLoopback));
+    }
+    QVERIFY(std::filesystem::is_regular_file(path));
+    std::filesystem::remove(path);
+
+    //上次运行残留的套接字文件被替换
+    boost::asio::io_context ic;
+    {
+        boost::asio::local::stream_protocol::acceptor stale(ic, boost::asio::local::stream_protocol::endpoint(path.string()));
+    }
+    QVERIFY(std::filesystem::is_socket(path));
+
+    TcpServer server(option);
+    std::mutex lockMessage;
+    std::condition_variable received;
+    std::string lastMessage;
+    server.registerMessageProcessFunction([&](size_t, const std::string& message)
+    {
+        std::lock_guard<std::mutex> lg(lockMessage);
+        lastMessage = message;
+        received.notify_all();
+    });
+    QVERIFY(server.start(AnyLoopback));
+
+    boost::asio::local::stream_protocol::socket client(ic);
+    client.connect(boost::asio::local::stream_protocol::endpoint(path.string()));
+    boost::asio::write(client, boost::asio::buffer(std::string(R"({"action":"heartbeat"})")));
+    {
+        std::unique_lock<std::mutex> lk(lockMessage);
+        QVERIFY(received.wait_for(lk, std::chrono::seconds(10), [&]() { return !lastMessage.empty(); }));
+        QCOMPARE(lastMessage, std::string(R"({"action":"heartbeat"})"));
+    }
+    client.close();
+
+    //停止时删除套接字文件
+    server.stop();
+    QVERIFY(!std::filesystem::exists(path));
+#else
+    QSKIP("unix socket is not supported on this platform");
+#endif
+}
+
+void tst_TcpServer::banKickedAddress()
+{
+    //超出接收速率被断开后,同一地址的新连接在禁止时间内直接关闭,不加入连接表
+    TcpServerOption option;
+    option.ingressRate = 1;
+    option.ingressBurst = 1;
+    option.ingressKickThreshold = 1;
+    option.banTime = 60;
+    TcpServer server(option);
+
+    std::mutex lockConnection;
+    std::condition_variable changed;
+    size_t appended(0);
+    size_t blacklisted(0);
+    server.registerAppendConnnection([&](size_t id)
+    {
+        std::lock_guard<std::mutex> lg(lockConnection);
+        ++appended;
+        changed.notify_all();
+        return Jimmy::User(id);
+    });
+    server.registerBlacklistFunction([&](size_t)
+    {
+        std::lock_guard<std::mutex> lg(lockConnection);
+        ++blacklisted;
+        changed.notify_all();
+    });
+    QVERIFY(server.start(AnyLoopback));
+
+    const boost::asio::ip::tcp::endpoint serverEndpoint(boost::asio::ip::address_v4::loopback(), server.getPort());
+    boost::asio::io_context ic;
+    boost::asio::ip::tcp::socket client(ic);
+    client.connect(serverEndpoint);
+
+    std::string messages;
+    for (int i = 0; i < 3; ++i)
+    {
+        messages.append(R"({"action":"heartbeat"})");
+    }
+    boost::asio::write(client, boost::asio::buffer(messages));
+
+    char byte;
+    boost::system::error_code ec;
+    boost::asio::read(client, boost::asio::buffer(&byte, 1), ec);
+    QVERIFY(ec);
+    {
+        std::unique_lock<std::mutex> lk(lockConnection);
+        QVERIFY(changed.wait_for(lk, std::chrono::seconds(10), [&]() { return blacklisted == 1; }));
+    }
+
+    boost::asio::ip::tcp::socket banned(ic);
+    banned.connect(serverEndpoint);
+    boost::asio::read(banned, boost::asio::buffer(&byte, 1), ec);
+    QVERIFY(ec);
+    {
+        std::lock_guard<std::mutex> lg(lockConnection);
+        QCOMPARE(appended, size_t(1));
+    }
+
+    server.stop();
+}
+
+QTEST_APPLESS_MAIN(tst_TcpServer)
+
+#include "tst_tcpserver.moc"
@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+TARGET = tst_tcpserver
+
+SOURCES += \
+    tst_tcpserver.cpp
@@ -0,0 +1,157 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <vector>
+#include "timerwheel.h"
+
+using namespace Jimmy;
+using namespace std::chrono;
+
+class tst_TimerWheel : public QObject
+{
+    Q_OBJECT
+private slots:
+    void expire();
+    void repeat();
+    void beyondOneRound();
+    void released();
+};
+
+namespace
+{
+
+//记录每次到期时的 tick,interval 不为 0 时按该间隔重复
+class Recorder : public TimerWheel::Handler
+{
+public:
+    explicit Recorder(uint64_t interval = 0) :interval_(interval) {}
+
+    uint64_t onTimerWheel(uint64_t now) override
+    {
+        ticks.push_back(now);
+        return (interval_ == 0) ? 0 : now + interval_;
+    }
+
+    std::vector<uint64_t> ticks;
+private:
+    uint64_t interval_;
+};
+
+const auto TickInterval = milliseconds(5);
+
+//运行到时间轮走过 ticks 个 tick 为止
+void runTicks(boost::asio::io_context& ic, TimerWheel& wheel, uint64_t ticks)
+{
+    while (wheel.now() < ticks)
+    {
+        ic.run_one_for(seconds(1));
+    }
+}
+
+}
+
+void tst_TimerWheel::expire()
+{
+    boost::asio::io_context ic;
+    TimerWheel wheel(ic, 8, TickInterval);
+    auto recorder = std::make_shared<Recorder>();
+    auto overdue = std::make_shared<Recorder>();
+
+    wheel.start();
+    wheel.add(recorder, 3);
+    wheel.add(overdue, 0);
+    runTicks(ic, wheel, 5);
+    wheel.stop();
+
+    QCOMPARE(recorder->ticks, std::vector<uint64_t>({ 3 }));
+
+    //已经到期的在下一个 tick 处理
+    QCOMPARE(overdue->ticks, std::vector<uint64_t>({ 1 }));
+}
+
+void tst_TimerWheel::repeat()
+{
+    boost::asio::io_context ic;
+    TimerWheel wheel(ic, 8, TickInterval);
+    auto recorder = std::make_shared<Recorder>(2);
+
+    wheel.start();
+    wheel.add(recorder, 2);
+    runTicks(ic, wheel, 7);
+    wheel.stop();
+
+    QCOMPARE(recorder->ticks, std::vector<uint64_t>({ 2, 4, 6 }));
+}
+
+void tst_TimerWheel::beyondOneRound()
+{
+    //到期时间超过一圈的对象会在同一个槽中提前被检查,由 onTimerWheel 放回
+    class Deadline : public TimerWheel::Handler
+    {
+    public:
+        uint64_t onTimerWheel(uint64_t now) override
+        {
+            checks.push_back(now);
+            return (now < 10) ? 10 : 0;
+        }
+
+        std::vector<uint64_t> checks;
+    };
+
+    boost::asio::io_context ic;
+    TimerWheel wheel(ic, 4, TickInterval);
+    auto deadline = std::make_shared<Deadline>();
+
+    wheel.start();
+    wheel.add(deadline, 10);
+    runTicks(ic, wheel, 11);
+    wheel.stop();
+
+    QCOMPARE(deadline->checks, std::vector<uint64_t>({ 2, 6, 10 }));
+}
+
+void tst_TimerWheel::released()
+{
+    boost::asio::io_context ic;
+    TimerWheel wheel(ic, 8, TickInterval);
+    auto recorder = std::make_shared<Recorder>(1);
+    std::weak_ptr<Recorder> weak = recorder;
+
+    wheel.start();
+    wheel.add(recorder, 1);
+    runTicks(ic, wheel, 2);
+    QCOMPARE(recorder->ticks.size(), size_t(2));
+
+    //释放后不再被调用,时间轮只保存弱引用
+    recorder.reset();
+    runTicks(ic, wheel, 4);
+    wheel.stop();
+    QVERIFY(weak.expired());
+}
+
+QTEST_APPLESS_MAIN(tst_TimerWheel)
+
+#include "tst_timerwheel.moc"
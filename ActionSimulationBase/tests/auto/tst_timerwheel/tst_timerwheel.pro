@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+TARGET = tst_timerwheel
+
+SOURCES += \
+    tst_timerwheel.cpp
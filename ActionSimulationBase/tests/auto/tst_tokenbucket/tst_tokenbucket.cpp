@@ -0,0 +1,110 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include "tokenbucket.h"
+
+using namespace Jimmy;
+using namespace std::chrono;
+
+class tst_TokenBucket : public QObject
+{
+    Q_OBJECT
+private slots:
+    void disabled();
+    void burst();
+    void refill();
+    void capacity();
+};
+
+void tst_TokenBucket::disabled()
+{
+    TokenBucket bucket;
+    QVERIFY(!bucket.enabled());
+    for (int i = 0; i < 1000; ++i)
+    {
+        QVERIFY(bucket.consume());
+    }
+}
+
+void tst_TokenBucket::burst()
+{
+    auto start = steady_clock::now();
+
+    //burst 为 0 时与 rate 相同
+    TokenBucket bucket;
+    bucket.reset(10, 0, start);
+    QVERIFY(bucket.enabled());
+    for (int i = 0; i < 10; ++i)
+    {
+        QVERIFY(bucket.consume(start));
+    }
+    QVERIFY(!bucket.consume(start));
+
+    bucket.reset(10, 3, start);
+    for (int i = 0; i < 3; ++i)
+    {
+        QVERIFY(bucket.consume(start));
+    }
+    QVERIFY(!bucket.consume(start));
+}
+
+void tst_TokenBucket::refill()
+{
+    auto start = steady_clock::now();
+
+    TokenBucket bucket;
+    bucket.reset(10, 1, start);
+    QVERIFY(bucket.consume(start));
+    QVERIFY(!bucket.consume(start + milliseconds(50)));
+
+    //每 100 毫秒补充一个令牌
+    QVERIFY(bucket.consume(start + milliseconds(100)));
+    QVERIFY(!bucket.consume(start + milliseconds(100)));
+}
+
+void tst_TokenBucket::capacity()
+{
+    auto start = steady_clock::now();
+
+    TokenBucket bucket;
+    bucket.reset(100, 5, start);
+    for (int i = 0; i < 5; ++i)
+    {
+        QVERIFY(bucket.consume(start));
+    }
+
+    //长时间空闲后最多积累 burst 个令牌
+    auto later = start + seconds(60);
+    for (int i = 0; i < 5; ++i)
+    {
+        QVERIFY(bucket.consume(later));
+    }
+    QVERIFY(!bucket.consume(later));
+}
+
+QTEST_APPLESS_MAIN(tst_TokenBucket)
+
+#include "tst_tokenbucket.moc"
@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+TARGET = tst_tokenbucket
+
+SOURCES += \
+    tst_tokenbucket.cpp
@@ -0,0 +1,150 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <atomic>
+#include <chrono>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "writerpreferringmutex.h"
+
+using namespace Jimmy;
+
+class tst_WriterPreferringMutex : public QObject
+{
+    Q_OBJECT
+private slots:
+    void tryLock();
+    void exclusive();
+    void writerNotStarved();
+};
+
+void tst_WriterPreferringMutex::tryLock()
+{
+    WriterPreferringMutex mutex;
+
+    mutex.lock_shared();
+    QVERIFY(!mutex.try_lock());
+    QVERIFY(mutex.try_lock_shared());
+    mutex.unlock_shared();
+    mutex.unlock_shared();
+
+    mutex.lock();
+    QVERIFY(!mutex.try_lock());
+    QVERIFY(!mutex.try_lock_shared());
+    mutex.unlock();
+
+    QVERIFY(mutex.try_lock());
+    mutex.unlock();
+}
+
+void tst_WriterPreferringMutex::exclusive()
+{
+    //写锁与其他写锁和读锁互斥
+    WriterPreferringMutex mutex;
+    bool writing(false);
+    size_t counter(0);
+    std::atomic<size_t> overlapped(0);
+
+    const int threadCount = 4;
+    const size_t loops = 10000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([&, i]()
+        {
+            for (size_t j = 0; j < loops; ++j)
+            {
+                if ((i + j) % 2 == 0)
+                {
+                    std::lock_guard<WriterPreferringMutex> lg(mutex);
+                    if (writing)
+                    {
+                        ++overlapped;
+                    }
+                    writing = true;
+                    ++counter;
+                    writing = false;
+                }
+                else
+                {
+                    std::shared_lock<WriterPreferringMutex> lg(mutex);
+                    if (writing)
+                    {
+                        ++overlapped;
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    QCOMPARE(overlapped.load(), size_t(0));
+    QCOMPARE(counter, threadCount * loops / 2);
+}
+
+void tst_WriterPreferringMutex::writerNotStarved()
+{
+    //读锁的持有时间互相重叠,任何时刻都有读者,写者仍能在等待的读者之前拿到锁
+    WriterPreferringMutex mutex;
+    std::atomic_bool isRun(true);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i)
+    {
+        readers.emplace_back([&]()
+        {
+            while (isRun)
+            {
+                std::shared_lock<WriterPreferringMutex> lg(mutex);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (int i = 0; i < 10; ++i)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        mutex.lock();
+        auto waited = std::chrono::steady_clock::now() - begin;
+        mutex.unlock();
+        QVERIFY(waited < std::chrono::seconds(1));
+    }
+
+    isRun = false;
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+}
+
+QTEST_APPLESS_MAIN(tst_WriterPreferringMutex)
+
+#include "tst_writerpreferringmutex.moc"
@@ -0,0 +1,6 @@
+include(../../tests.pri)
+
+TARGET = tst_writerpreferringmutex
+
+SOURCES += \
+    tst_writerpreferringmutex.cpp
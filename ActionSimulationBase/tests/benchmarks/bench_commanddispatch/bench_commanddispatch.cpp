@@ -0,0 +1,236 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <QPair>
+#include <QQueue>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "flatjsonparser.h"
+#include "writerpreferringmutex.h"
+
+using namespace Jimmy;
+
+//服务端 ProjectManager 命令分发的摘录:数据命令按连接号分配到各分片线程,分片线程在读锁下解析执行,
+//控制线程每 10ms 取一次写锁(相当于 load / run / stop)
+//每个客户端一个线程,相当于 io 线程上该连接的 pushMessage,统计不同客户端数下每秒处理的数据命令数
+class bench_CommandDispatch : public QObject
+{
+    Q_OBJECT
+private slots:
+    void commands_data();
+    void commands();
+};
+
+static const size_t CommandsPerClient = 20000;
+
+class CommandDispatcher
+{
+public:
+    explicit CommandDispatcher(size_t shardCount)
+        :isRun_(true)
+        , controlCommands_(0)
+    {
+        for (size_t i = 0; i < shardCount; ++i)
+        {
+            auto shard = std::make_unique<CommandShard>();
+            shard->thread = std::thread(&CommandDispatcher::commandTcpDataThread, this, shard.get());
+            commandShards_.push_back(std::move(shard));
+        }
+
+        controlThread_ = std::thread([this]()
+        {
+            while (isRun_)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                std::lock_guard<WriterPreferringMutex> lg(lockCommand_);
+                ++controlCommands_;
+            }
+        });
+    }
+
+    ~CommandDispatcher()
+    {
+        isRun_ = false;
+        for (auto& shard : commandShards_)
+        {
+            {
+                std::lock_guard<std::mutex> lg(shard->lockMsgData);
+            }
+            shard->cvMsgData.notify_all();
+            shard->thread.join();
+        }
+
+        controlThread_.join();
+    }
+
+    void appendMessage(size_t connectionId, const std::string& message)
+    {
+        auto& shard = *commandShards_[connectionId % commandShards_.size()];
+        {
+            std::lock_guard<std::mutex> lg(shard.lockMsgData);
+            shard.msgData.push_back(QPair<size_t,std::string>(connectionId, message));
+        }
+
+        shard.cvMsgData.notify_one();
+    }
+
+    size_t processed()
+    {
+        size_t count(0);
+        for (auto& shard : commandShards_)
+        {
+            count += shard->processed;
+        }
+
+        return count;
+    }
+
+    size_t controlCommands() { return controlCommands_; }
+private:
+    struct alignas(64) CommandShard
+    {
+        QQueue<QPair<size_t,std::string>> msgData;
+        std::mutex lockMsgData;
+        std::condition_variable cvMsgData;
+        std::thread thread;
+        std::atomic<size_t> processed{0};
+    };
+
+    void commandTcpDataThread(CommandShard* shard)
+    {
+        while (isRun_)
+        {
+            QQueue<QPair<size_t,std::string>> tcpData;
+            {
+                std::unique_lock<std::mutex> lg(shard->lockMsgData);
+                shard->cvMsgData.wait(lg, [this, shard] {return (!isRun_) || (!shard->msgData.empty()); });
+                if (!isRun_) { break; }
+                tcpData.swap(shard->msgData);
+            }
+
+            while (!tcpData.empty())
+            {
+                auto data = tcpData.dequeue();
+                disposeCommand(data.second);
+                ++shard->processed;
+            }
+        }
+    }
+
+    //与 disposeComponentStatusChange_ 相同:在读锁下直接从 UTF-8 数据取出 action / cid / value
+    void disposeCommand(const std::string& message)
+    {
+        std::shared_lock<WriterPreferringMutex> lg(lockCommand_);
+        FlatJsonParser parser;
+        if (parser.parse(message.data(), message.size()))
+        {
+            parser.find("action");
+            parser.find("cid");
+            parser.find("value");
+        }
+    }
+
+    std::vector<std::unique_ptr<CommandShard>> commandShards_;
+    std::thread controlThread_;
+    WriterPreferringMutex lockCommand_;
+    std::atomic_bool isRun_;
+    std::atomic<size_t> controlCommands_;
+};
+
+void bench_CommandDispatch::commands_data()
+{
+    QTest::addColumn<int>("shards");
+    QTest::addColumn<int>("clients");
+
+    //command_threads 为 0 时分片数与 CPU 核数相同,单分片作为对照
+    const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int shards : { 1, cores })
+    {
+        for (int clients : { 1, 2, 4, 8, 16, 64 })
+        {
+            QTest::addRow("%d shards %d clients", shards, clients) << shards << clients;
+        }
+
+        if (cores == 1)
+        {
+            break;
+        }
+    }
+}
+
+void bench_CommandDispatch::commands()
+{
+    QFETCH(int, shards);
+    QFETCH(int, clients);
+
+    const size_t total = static_cast<size_t>(clients) * CommandsPerClient;
+    CommandDispatcher dispatcher(static_cast<size_t>(shards));
+
+    size_t controlCommands(0);
+    auto begin = std::chrono::steady_clock::now();
+    QBENCHMARK_ONCE
+    {
+        std::vector<std::thread> connections;
+        for (int i = 0; i < clients; ++i)
+        {
+            connections.emplace_back([&dispatcher, i]()
+            {
+                const std::string command(R"({"action":"component_status_change","cid":"T1","value":1})");
+                for (size_t j = 0; j < CommandsPerClient; ++j)
+                {
+                    dispatcher.appendMessage(static_cast<size_t>(i + 1), command);
+                }
+            });
+        }
+
+        for (auto& connection : connections)
+        {
+            connection.join();
+        }
+
+        while (dispatcher.processed() < total)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        controlCommands = dispatcher.controlCommands();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    qDebug("%s: %.0f commands/s, %.1f control commands/s", QTest::currentDataTag(),
+           total / seconds, controlCommands / seconds);
+}
+
+QTEST_APPLESS_MAIN(bench_CommandDispatch)
+
+#include "bench_commanddispatch.moc"
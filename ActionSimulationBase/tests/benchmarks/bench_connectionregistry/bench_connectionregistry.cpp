@@ -0,0 +1,203 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "tcpserver.h"
+
+using namespace Jimmy;
+
+//多个线程同时向大量连接调用 sendData,测量连接表的争用
+//"churn" 行另有一个线程不断建立和断开连接,接受和移除连接需要对分片加写锁
+//写合并窗口使发送主要是入队,耗时集中在连接表查找和入队上
+class bench_ConnectionRegistry : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void sendData_data();
+    void sendData();
+private:
+    void startRead_(boost::asio::ip::tcp::socket& socket);
+private:
+    std::unique_ptr<TcpServer> server_;
+    boost::asio::io_context clientContext_;
+    std::unique_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> clientWork_;
+    std::thread clientThread_;
+    std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> clients_;
+    std::vector<char> readBuffer_;
+
+    std::mutex lockConnections_;
+    std::condition_variable accepted_;
+    std::vector<size_t> connectionIds_;
+};
+
+static const size_t ConnectionCount = 512;
+static const size_t MessagesPerSender = 50000;
+
+void bench_ConnectionRegistry::startRead_(boost::asio::ip::tcp::socket& socket)
+{
+    //客户端持续读取并丢弃数据,服务端发送队列不会堆积
+    socket.async_read_some(boost::asio::buffer(readBuffer_), [this, &socket](const boost::system::error_code& ec, size_t)
+    {
+        if (!ec)
+        {
+            startRead_(socket);
+        }
+    });
+}
+
+void bench_ConnectionRegistry::initTestCase()
+{
+    TcpServerOption option;
+    option.ioContextCount = 4;
+    option.writeBatchWindow = 1000;
+    option.writeQueueMaxMessages = 0;
+    server_ = std::make_unique<TcpServer>(option);
+
+    //只记录参与发送的连接,之后的连接只用于制造写锁争用
+    server_->registerAppendConnnection([this](size_t id)
+    {
+        std::lock_guard<std::mutex> lg(lockConnections_);
+        if (connectionIds_.size() < ConnectionCount)
+        {
+            connectionIds_.push_back(id);
+            accepted_.notify_all();
+        }
+        return Jimmy::User(id);
+    });
+    QVERIFY(server_->start(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)));
+
+    readBuffer_.resize(64 * 1024);
+    for (size_t i = 0; i < ConnectionCount; ++i)
+    {
+        clients_.push_back(std::make_unique<boost::asio::ip::tcp::socket>(clientContext_));
+        clients_.back()->connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), server_->getPort()));
+    }
+
+    {
+        std::unique_lock<std::mutex> lk(lockConnections_);
+        QVERIFY(accepted_.wait_for(lk, std::chrono::seconds(30), [&]() { return connectionIds_.size() == ConnectionCount; }));
+    }
+
+    for (auto& client : clients_)
+    {
+        startRead_(*client);
+    }
+    clientWork_ = std::make_unique<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>(clientContext_.get_executor());
+    clientThread_ = std::thread([this]() { clientContext_.run(); });
+}
+
+void bench_ConnectionRegistry::cleanupTestCase()
+{
+    clientWork_.reset();
+    boost::asio::post(clientContext_, [this]() { clients_.clear(); });
+    if (clientThread_.joinable())
+    {
+        clientThread_.join();
+    }
+
+    if (server_)
+    {
+        server_->stop();
+    }
+}
+
+void bench_ConnectionRegistry::sendData_data()
+{
+    QTest::addColumn<int>("senders");
+    QTest::addColumn<bool>("churn");
+
+    for (int senders : {1, 2, 4, 8, 16})
+    {
+        QTest::addRow("%d senders", senders) << senders << false;
+        QTest::addRow("%d senders, churn", senders) << senders << true;
+    }
+}
+
+void bench_ConnectionRegistry::sendData()
+{
+    QFETCH(int, senders);
+    QFETCH(bool, churn);
+
+    const QByteArray message(R"({"cid":"temperature_1","value":25.5})");
+
+    std::atomic<bool> stopChurn(false);
+    std::thread churnThread;
+    if (churn)
+    {
+        churnThread = std::thread([this, &stopChurn]()
+        {
+            boost::asio::io_context ic;
+            boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), server_->getPort());
+            while (!stopChurn)
+            {
+                boost::asio::ip::tcp::socket socket(ic);
+                boost::system::error_code ec;
+                socket.connect(endpoint, ec);
+                socket.close(ec);
+            }
+        });
+    }
+
+    //每轮共发送 senders * MessagesPerSender 条消息
+    QBENCHMARK
+    {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < senders; ++t)
+        {
+            threads.emplace_back([this, t, &message]()
+            {
+                size_t index = static_cast<size_t>(t) * 7;
+                for (size_t i = 0; i < MessagesPerSender; ++i)
+                {
+                    server_->sendData(connectionIds_[(index + i) % connectionIds_.size()], message);
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    stopChurn = true;
+    if (churnThread.joinable())
+    {
+        churnThread.join();
+    }
+}
+
+QTEST_APPLESS_MAIN(bench_ConnectionRegistry)
+
+#include "bench_connectionregistry.moc"
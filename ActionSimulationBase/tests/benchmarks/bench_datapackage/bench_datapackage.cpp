@@ -0,0 +1,117 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <string>
+#include "datapackage.h"
+#include "commonconst.h"
+
+using namespace Jimmy;
+
+//load_project 大小的消息按不同的块大小分多次交给 DataPackage,对比分帧方式和块大小对组包耗时的影响
+//块越小,跨块保存的扫描状态和未完成包的缓存越频繁
+class bench_DataPackage : public QObject
+{
+    Q_OBJECT
+private slots:
+    void push_data();
+    void push();
+};
+
+//与 load_project 回复结构相近的大消息,字符串中含有大括号和转义字符
+static std::string makeProject(int componentCount)
+{
+    std::string data("{\"action\":\"load_project\",\"result\":\"succeed\",\"name\":\"bench\",\"components\":{");
+    for (int i = 0; i < componentCount; ++i)
+    {
+        auto id = std::to_string(i);
+        if (i > 0)
+        {
+            data.append(",");
+        }
+        data.append("\"component_").append(id).append("\":{\"component_type\":1,\"behavior_type\":0,")
+            .append("\"name\":\"组件 ").append(id).append(" {\\\"说明\\\"}\",")
+            .append("\"subscription\":[\"component_").append(std::to_string(i / 2)).append("\"],")
+            .append("\"default_value\":").append(std::to_string(i % 7)).append("}");
+    }
+    data.append("}}");
+    return data;
+}
+
+static std::string lengthPrefix(const std::string& message)
+{
+    std::string data(1, static_cast<char>(CommonConst::LengthPrefixMagic));
+    size_t length = message.size();
+    data.push_back(static_cast<char>((length >> 24) & 0xFF));
+    data.push_back(static_cast<char>((length >> 16) & 0xFF));
+    data.push_back(static_cast<char>((length >> 8) & 0xFF));
+    data.push_back(static_cast<char>(length & 0xFF));
+    data.append(message);
+    return data;
+}
+
+void bench_DataPackage::push_data()
+{
+    QTest::addColumn<bool>("prefix");
+    QTest::addColumn<int>("chunkSize");
+
+    for (int chunkSize : {64, 1460, 16384})
+    {
+        QTest::addRow("brace, %d byte chunks", chunkSize) << false << chunkSize;
+        QTest::addRow("length prefix, %d byte chunks", chunkSize) << true << chunkSize;
+    }
+}
+
+void bench_DataPackage::push()
+{
+    QFETCH(bool, prefix);
+    QFETCH(int, chunkSize);
+
+    const std::string message = makeProject(5000);
+    const std::string stream = prefix ? lengthPrefix(message) : message;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(stream.data());
+
+    size_t received(0);
+    QBENCHMARK
+    {
+        //每轮使用新的组包器,分帧方式由第一个字节重新确定
+        DataPackage package(1);
+        package.registerMessageProcessFunction([&received](size_t, const std::string& msg)
+        {
+            received = msg.size();
+        });
+
+        for (size_t pos = 0; pos < stream.size(); pos += static_cast<size_t>(chunkSize))
+        {
+            package.pushData(data + pos, std::min(static_cast<size_t>(chunkSize), stream.size() - pos));
+        }
+    }
+
+    QCOMPARE(received, message.size());
+}
+
+QTEST_APPLESS_MAIN(bench_DataPackage)
+
+#include "bench_datapackage.moc"
@@ -0,0 +1,122 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include "flatjsonparser.h"
+
+using namespace Jimmy;
+
+//在客户端消息上比较 FlatJsonParser 和 QJsonDocument 的解析耗时,消息文件每行一条消息
+//同目录下的 traffic.jsonl 只是按协议手写的 24 条示例消息,用于编译后能直接运行;
+//有意义的数据需要用环境变量 FLATJSON_TRAFFIC 指定从实际部署中录制的消息文件
+class bench_FlatJsonParser : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void parse_data();
+    void parse();
+private:
+    QList<QByteArray> messages_;
+};
+
+void bench_FlatJsonParser::initTestCase()
+{
+    QString fileName = qEnvironmentVariable("FLATJSON_TRAFFIC");
+    if (fileName.isEmpty())
+    {
+        qWarning("FLATJSON_TRAFFIC is not set, using the hand-written sample traffic.jsonl");
+        fileName = QFINDTESTDATA("traffic.jsonl");
+    }
+
+    QFile file(fileName);
+    QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(fileName));
+    while (!file.atEnd())
+    {
+        QByteArray line = file.readLine().trimmed();
+        if (!line.isEmpty())
+        {
+            messages_.append(line);
+        }
+    }
+    QVERIFY(!messages_.isEmpty());
+
+    //走快速路径的消息比例决定了实际收益,转义、嵌套等消息仍由 QJsonDocument 解析
+    int flat(0);
+    FlatJsonParser parser;
+    for (const QByteArray& message : messages_)
+    {
+        if (parser.parse(message.constData(), static_cast<size_t>(message.size())))
+        {
+            ++flat;
+        }
+    }
+    qDebug("%d messages, %d parsed by FlatJsonParser", messages_.size(), flat);
+}
+
+void bench_FlatJsonParser::parse_data()
+{
+    QTest::addColumn<bool>("flat");
+
+    QTest::newRow("FlatJsonParser") << true;
+    QTest::newRow("QJsonDocument") << false;
+}
+
+void bench_FlatJsonParser::parse()
+{
+    QFETCH(bool, flat);
+
+    //与服务端一样取出 cid 和 value,快速路径失败时改用 QJsonDocument
+    FlatJsonParser parser;
+    QBENCHMARK
+    {
+        for (const QByteArray& message : messages_)
+        {
+            if (flat && parser.parse(message.constData(), static_cast<size_t>(message.size())))
+            {
+                auto cid = parser.find("cid");
+                auto value = parser.find("value");
+                if ((cid != nullptr) && (value != nullptr))
+                {
+                    FlatJsonParser::toString(*cid);
+                    FlatJsonParser::toValue(*value);
+                }
+                continue;
+            }
+
+            QJsonObject jo = QJsonDocument::fromJson(message).object();
+            jo.value("cid").toString();
+            jo.value("value");
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(bench_FlatJsonParser)
+
+#include "bench_flatjsonparser.moc"
@@ -0,0 +1,12 @@
+include(../../tests.pri)
+
+# 性能测试不加入 make check,需要时单独运行
+CONFIG -= testcase
+
+TARGET = bench_flatjsonparser
+
+SOURCES += \
+    bench_flatjsonparser.cpp
+
+DISTFILES += \
+    traffic.jsonl
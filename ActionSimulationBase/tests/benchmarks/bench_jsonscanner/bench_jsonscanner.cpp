@@ -0,0 +1,98 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include "jsonscanner.h"
+
+using namespace Jimmy;
+
+//对比运行时选择的实现(avx2/sse2)与逐字节实现扫描整段数据的耗时
+class bench_JsonScanner : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void scan_data();
+    void scan();
+};
+
+//组件值消息,字段值越长结构字符越稀疏
+static QByteArray makeMessages(int valueLength, int count)
+{
+    QByteArray data;
+    QByteArray value(valueLength, 'x');
+    for (int i = 0; i < count; ++i)
+    {
+        data.append("{\"action\":\"update_value\",\"cid\":\"T").append(QByteArray::number(i % 100))
+            .append("\",\"value\":\"").append(value).append("\"}");
+    }
+
+    return data;
+}
+
+void bench_JsonScanner::initTestCase()
+{
+    qDebug("backend: %s", JsonScanner::backendName());
+}
+
+void bench_JsonScanner::scan_data()
+{
+    QTest::addColumn<bool>("scalar");
+    QTest::addColumn<QByteArray>("data");
+
+    QByteArray dense = makeMessages(4, 20000);
+    QByteArray sparse = makeMessages(256, 2000);
+
+    QTest::newRow("short values, selected") << false << dense;
+    QTest::newRow("short values, scalar") << true << dense;
+    QTest::newRow("long values, selected") << false << sparse;
+    QTest::newRow("long values, scalar") << true << sparse;
+}
+
+void bench_JsonScanner::scan()
+{
+    QFETCH(bool, scalar);
+    QFETCH(QByteArray, data);
+
+    auto find = scalar ? JsonScanner::findStructuralScalar : JsonScanner::findStructural;
+    const uint8_t* begin = reinterpret_cast<const uint8_t*>(data.constData());
+    const size_t length = static_cast<size_t>(data.size());
+
+    size_t count(0);
+    QBENCHMARK
+    {
+        count = 0;
+        for (size_t pos = find(begin, 0, length); pos < length; pos = find(begin, pos + 1, length))
+        {
+            ++count;
+        }
+    }
+
+    QVERIFY(count > 0);
+}
+
+QTEST_APPLESS_MAIN(bench_JsonScanner)
+
+#include "bench_jsonscanner.moc"
@@ -0,0 +1,174 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <QCborMap>
+#include <QCborValue>
+#include <QJsonDocument>
+#include "messagecodec.h"
+
+using namespace Jimmy;
+
+//比较 json 与 cbor 的编码、解码耗时和线上字节数
+//"cbor (QCborMap)" 为先生成 json 文本再转换为 QCborMap 的做法,作为直接编码的对照
+class bench_MessageCodec : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void encode_data();
+    void encode();
+    void decode_data();
+    void decode();
+private:
+    void addMessages_(const char* codec, int codecId);
+private:
+    QList<QPair<QByteArray, QJsonObject>> messages_;
+};
+
+enum CodecId { Json, Cbor, CborViaText };
+
+void bench_MessageCodec::initTestCase()
+{
+    auto add = [this](const char* name, const char* json)
+    {
+        messages_.append(qMakePair(QByteArray(name), QJsonDocument::fromJson(json).object()));
+    };
+
+    add("component change", R"({"cid":"temperature_1","value":25.5})");
+    add("handle change", R"({"h":12,"v":25.5})");
+    add("session change", R"({"cid":"温度传感器","value":"状态:正常","sid":7})");
+    add("login reply", R"({"action":"login","userid":3,"role":1,"result":"succeed","handle":{"T1":0,"T2":1,"T3":2}})");
+
+    //resync 的完整状态快照
+    QJsonObject values;
+    for (int i = 0; i < 200; ++i)
+    {
+        values.insert(QStringLiteral("component_%1").arg(i), (i % 3 == 0) ? QJsonValue(i * 0.5) : QJsonValue(i));
+    }
+    QJsonObject resync;
+    resync.insert("action", "resync");
+    resync.insert("result", "succeed");
+    resync.insert("values", values);
+    messages_.append(qMakePair(QByteArray("resync 200"), resync));
+
+    foreach (const auto& message, messages_)
+    {
+        auto json = MessageCodec::toJson(message.second).size();
+        auto cbor = MessageCodec::toCbor(message.second).size();
+        auto cborViaText = QCborMap::fromJsonObject(message.second).toCborValue().toCbor().size();
+        qDebug("%-18s json %6d bytes, cbor %6d bytes (%3d%%), cbor without key table %6d bytes",
+               message.first.constData(), json, cbor, cbor * 100 / json, cborViaText);
+    }
+}
+
+void bench_MessageCodec::addMessages_(const char* codec, int codecId)
+{
+    foreach (const auto& message, messages_)
+    {
+        QTest::addRow("%s %s", message.first.constData(), codec) << codecId << message.second;
+    }
+}
+
+void bench_MessageCodec::encode_data()
+{
+    QTest::addColumn<int>("codec");
+    QTest::addColumn<QJsonObject>("message");
+
+    addMessages_("json", Json);
+    addMessages_("cbor", Cbor);
+    addMessages_("cbor (QCborMap)", CborViaText);
+}
+
+void bench_MessageCodec::encode()
+{
+    QFETCH(int, codec);
+    QFETCH(QJsonObject, message);
+
+    QByteArray data;
+    switch (codec)
+    {
+    case Json:
+        QBENCHMARK
+        {
+            data = MessageCodec::toJson(message);
+        }
+        break;
+    case Cbor:
+        QBENCHMARK
+        {
+            data = MessageCodec::toCbor(message);
+        }
+        break;
+    default:
+        QBENCHMARK
+        {
+            auto text = MessageCodec::toJson(message);
+            data = QCborMap::fromJsonObject(QJsonDocument::fromJson(text).object()).toCborValue().toCbor();
+        }
+        break;
+    }
+    QVERIFY(!data.isEmpty());
+}
+
+void bench_MessageCodec::decode_data()
+{
+    QTest::addColumn<int>("codec");
+    QTest::addColumn<QJsonObject>("message");
+
+    addMessages_("json", Json);
+    addMessages_("cbor", Cbor);
+}
+
+void bench_MessageCodec::decode()
+{
+    QFETCH(int, codec);
+    QFETCH(QJsonObject, message);
+
+    QJsonObject decoded;
+    if (codec == Json)
+    {
+        auto data = MessageCodec::toJson(message);
+        QBENCHMARK
+        {
+            decoded = QJsonDocument::fromJson(data).object();
+        }
+    }
+    else
+    {
+        auto data = MessageCodec::toCbor(message);
+        QString error;
+        QBENCHMARK
+        {
+            decoded = QJsonObject();
+            MessageCodec::fromCbor(data, decoded, error);
+        }
+    }
+    QCOMPARE(decoded, message);
+}
+
+QTEST_APPLESS_MAIN(bench_MessageCodec)
+
+#include "bench_messagecodec.moc"
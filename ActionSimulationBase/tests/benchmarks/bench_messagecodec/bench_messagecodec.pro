@@ -0,0 +1,9 @@
+include(../../tests.pri)
+
+# 性能测试不加入 make check,需要时单独运行
+CONFIG -= testcase
+
+TARGET = bench_messagecodec
+
+SOURCES += \
+    bench_messagecodec.cpp
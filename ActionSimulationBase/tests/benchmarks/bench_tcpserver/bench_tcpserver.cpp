@@ -0,0 +1,137 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tcpserver.h"
+#include "iocontextpool.h"
+#include "flatjsonparser.h"
+
+using namespace Jimmy;
+
+//多个客户端同时发送小消息,比较不同 io_threads 下服务端的组包和解析吞吐量
+//CONFIG+=io_uring 时同时生成 bench_tcpserver_epoll,两者输出对比 io_uring 和 epoll
+class bench_TcpServer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void throughput_data();
+    void throughput();
+};
+
+static const size_t ClientCount = 16;
+static const size_t MessagesPerClient = 20000;
+
+void bench_TcpServer::initTestCase()
+{
+    qDebug("backend: %s", IoContextPool::backendName());
+}
+
+void bench_TcpServer::throughput_data()
+{
+    QTest::addColumn<int>("ioThreads");
+
+    QTest::newRow("io_threads 1") << 1;
+    QTest::newRow("io_threads 2") << 2;
+    QTest::newRow("io_threads 4") << 4;
+    QTest::newRow("io_threads 8") << 8;
+}
+
+void bench_TcpServer::throughput()
+{
+    QFETCH(int, ioThreads);
+
+    TcpServerOption option;
+    option.ioContextCount = static_cast<size_t>(ioThreads);
+    TcpServer server(option);
+
+    //与服务端的快速路径一样在 io 线程上解析消息
+    std::mutex lockCount;
+    std::condition_variable received;
+    std::atomic<size_t> messageCount(0);
+    server.registerMessageProcessFunction([&](size_t, const std::string& message)
+    {
+        FlatJsonParser parser;
+        if (parser.parse(message.data(), message.size()) && (parser.find("value") != nullptr))
+        {
+            if (++messageCount % MessagesPerClient == 0)
+            {
+                std::lock_guard<std::mutex> lg(lockCount);
+                received.notify_all();
+            }
+        }
+    });
+
+    QVERIFY(server.start(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)));
+
+    boost::asio::io_context ic;
+    std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> clients;
+    for (size_t i = 0; i < ClientCount; ++i)
+    {
+        clients.push_back(std::make_unique<boost::asio::ip::tcp::socket>(ic));
+        clients.back()->connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), server.getPort()));
+    }
+
+    std::string payload;
+    for (size_t i = 0; i < MessagesPerClient; ++i)
+    {
+        payload.append(R"({"action":"update_value","cid":"T)").append(std::to_string(i % 100)).append(R"(","value":)").append(std::to_string(i)).append("}");
+    }
+
+    size_t expected(0);
+    QBENCHMARK
+    {
+        expected += ClientCount * MessagesPerClient;
+
+        std::vector<std::thread> writers;
+        for (auto& client : clients)
+        {
+            writers.emplace_back([&client, &payload]() { boost::asio::write(*client, boost::asio::buffer(payload)); });
+        }
+
+        for (auto& writer : writers)
+        {
+            writer.join();
+        }
+
+        std::unique_lock<std::mutex> lk(lockCount);
+        QVERIFY(received.wait_for(lk, std::chrono::seconds(60), [&]() { return messageCount >= expected; }));
+    }
+
+    clients.clear();
+    server.stop();
+}
+
+QTEST_APPLESS_MAIN(bench_TcpServer)
+
+#include "bench_tcpserver.moc"
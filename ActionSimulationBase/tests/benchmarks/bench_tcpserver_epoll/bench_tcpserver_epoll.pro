@@ -0,0 +1,12 @@
+# 与 bench_tcpserver 相同的测试,在 CONFIG+=io_uring 编译时仍使用 epoll
+CONFIG -= io_uring
+
+include(../../tests.pri)
+
+# 性能测试不加入 make check,需要时单独运行
+CONFIG -= testcase
+
+TARGET = bench_tcpserver_epoll
+
+SOURCES += \
+    $$PWD/../bench_tcpserver/bench_tcpserver.cpp
@@ -0,0 +1,133 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QtTest>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include "tcpserver.h"
+
+using namespace Jimmy;
+
+//发送大数据时比较普通发送和 MSG_ZEROCOPY 的进程 CPU 时间(getrusage)
+//客户端读取的开销两种方式相同;回环地址上内核仍会复制数据,节省的 CPU 需要在两台机器之间才能完整体现
+class bench_ZeroCopy : public QObject
+{
+    Q_OBJECT
+private slots:
+    void sendCpu_data();
+    void sendCpu();
+};
+
+static const int MessageSize = 1024 * 1024;
+static const size_t MessageCount = 256;
+
+static double cpuMilliseconds(const timeval& tv)
+{
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+void bench_ZeroCopy::sendCpu_data()
+{
+    QTest::addColumn<int>("zeroCopyThreshold");
+
+    QTest::newRow("copy") << 0;
+    QTest::newRow("zerocopy") << 64 * 1024;
+}
+
+void bench_ZeroCopy::sendCpu()
+{
+    QFETCH(int, zeroCopyThreshold);
+
+    TcpServerOption option;
+    option.zeroCopyThreshold = static_cast<size_t>(zeroCopyThreshold);
+    option.writeQueueMaxBytes = 0;
+    TcpServer server(option);
+
+    std::mutex lockConnection;
+    std::condition_variable changed;
+    size_t connectionId(0);
+    server.registerAppendConnnection([&](size_t id)
+    {
+        std::lock_guard<std::mutex> lg(lockConnection);
+        connectionId = id;
+        changed.notify_all();
+        return Jimmy::User(id);
+    });
+    QVERIFY(server.start(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)));
+
+    boost::asio::io_context ic;
+    boost::asio::ip::tcp::socket client(ic);
+    client.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), server.getPort()));
+    {
+        std::unique_lock<std::mutex> lk(lockConnection);
+        QVERIFY(changed.wait_for(lk, std::chrono::seconds(10), [&]() { return connectionId != 0; }));
+    }
+
+    const QByteArray message(MessageSize, 'x');
+    const size_t totalBytes = MessageCount * MessageSize;
+
+    rusage before;
+    rusage after;
+    QBENCHMARK_ONCE
+    {
+        getrusage(RUSAGE_SELF, &before);
+
+        std::thread reader([&client, totalBytes]()
+        {
+            std::vector<char> buffer(256 * 1024);
+            size_t received(0);
+            boost::system::error_code ec;
+            while ((received < totalBytes) && (!ec))
+            {
+                received += client.read_some(boost::asio::buffer(buffer), ec);
+            }
+        });
+
+        for (size_t i = 0; i < MessageCount; ++i)
+        {
+            server.sendData(connectionId, message);
+        }
+
+        reader.join();
+        getrusage(RUSAGE_SELF, &after);
+    }
+
+    double user = cpuMilliseconds(after.ru_utime) - cpuMilliseconds(before.ru_utime);
+    double system = cpuMilliseconds(after.ru_stime) - cpuMilliseconds(before.ru_stime);
+    qDebug("%s: %zu MiB, cpu %.1f ms (user %.1f ms, sys %.1f ms)", QTest::currentDataTag(),
+           totalBytes / (1024 * 1024), user + system, user, system);
+
+    client.close();
+    server.stop();
+}
+
+QTEST_APPLESS_MAIN(bench_ZeroCopy)
+
+#include "bench_zerocopy.moc"
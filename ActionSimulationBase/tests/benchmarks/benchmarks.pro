@@ -0,0 +1,14 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    bench_commanddispatch \
+    bench_connectionregistry \
+    bench_datapackage \
+    bench_flatjsonparser \
+    bench_jsonscanner \
+    bench_messagecodec \
+    bench_tcpserver \
+    bench_zerocopy
+
+# 与 io_uring 版本对比的 epoll 版本
+linux:io_uring: SUBDIRS += bench_tcpserver_epoll
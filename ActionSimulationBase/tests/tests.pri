@@ -0,0 +1,12 @@
+# 单元测试和性能测试的公共设置,每个测试是一个独立的可执行文件
+QT += testlib
+QT -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+include($$PWD/../actionsimulationbase.pri)
+
+INCLUDEPATH += $$PWD/..
+
+DEFINES += _WIN32_WINNT=0x0601
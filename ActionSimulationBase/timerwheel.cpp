@@ -0,0 +1,103 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include "timerwheel.h"
+
+using namespace std;
+
+namespace Jimmy
+{
+
+TimerWheel::TimerWheel(boost::asio::io_context& ic, size_t slotCount, std::chrono::steady_clock::duration interval)
+    :timer_(ic)
+    , interval_(interval)
+    , slots_(slotCount == 0 ? 1 : slotCount)
+    , currentTick_(0)
+    , isRun_(false)
+{
+}
+
+void TimerWheel::start()
+{
+    if (isRun_)
+    {
+        return;
+    }
+
+    isRun_ = true;
+    timer_.expires_after(interval_);
+    timer_.async_wait(std::bind(&TimerWheel::tick, this, std::placeholders::_1));
+}
+
+void TimerWheel::stop()
+{
+    isRun_ = false;
+    timer_.cancel();
+}
+
+void TimerWheel::add(std::weak_ptr<Handler> handler, uint64_t deadline)
+{
+    //已经到期的放到下一个 tick 处理
+    if (deadline <= currentTick_)
+    {
+        deadline = currentTick_ + 1;
+    }
+
+    slots_[deadline % slots_.size()].push_back(handler);
+}
+
+void TimerWheel::tick(const boost::system::error_code& ec)
+{
+    if (ec || !isRun_)
+    {
+        return;
+    }
+
+    //按固定间隔触发,处理耗时不会累积误差
+    timer_.expires_at(timer_.expiry() + interval_);
+    timer_.async_wait(std::bind(&TimerWheel::tick, this, std::placeholders::_1));
+
+    ++currentTick_;
+
+    //槽中可能有未到期(超过一圈)的对象,由 onTimerWheel 返回真实的到期时间后重新放入
+    std::vector<std::weak_ptr<Handler>> expired;
+    expired.swap(slots_[currentTick_ % slots_.size()]);
+    for (auto& item : expired)
+    {
+        auto handler = item.lock();
+        if (!handler)
+        {
+            continue;
+        }
+
+        uint64_t deadline = handler->onTimerWheel(currentTick_);
+        if (deadline != 0)
+        {
+            add(handler, deadline);
+        }
+    }
+}
+
+}
@@ -0,0 +1,72 @@
+﻿#pragma once
+
+/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <boost/asio.hpp>
+#include <memory>
+#include <vector>
+#include <QtGlobal>
+
+namespace Jimmy
+{
+
+//哈希时间轮,每个 io_context 一个,所有对象共用一个每秒触发一次的定时器
+//只能在所属 io_context 的线程上访问
+class TimerWheel
+{
+    Q_DISABLE_COPY(TimerWheel)
+public:
+    class Handler
+    {
+    public:
+        virtual ~Handler() = default;
+
+        //到期时调用,返回下一次到期的 tick,返回 0 表示不再需要检查
+        virtual uint64_t onTimerWheel(uint64_t now) = 0;
+    };
+
+    TimerWheel(boost::asio::io_context& ic, size_t slotCount = 512,
+               std::chrono::steady_clock::duration interval = std::chrono::seconds(1));
+
+    void start();
+    void stop();
+
+    //启动后经过的 tick 数,每个 tick 的长度为 interval,缺省一秒
+    uint64_t now() const { return currentTick_; }
+
+    //对象只保存弱引用,释放后自动从时间轮中移除
+    void add(std::weak_ptr<Handler> handler, uint64_t deadline);
+private:
+    void tick(const boost::system::error_code& ec);
+private:
+    boost::asio::steady_timer timer_;
+    const std::chrono::steady_clock::duration interval_;
+    std::vector<std::vector<std::weak_ptr<Handler>>> slots_;
+    uint64_t currentTick_;
+    bool isRun_;
+};
+
+}
@@ -0,0 +1,83 @@
+﻿#pragma once
+
+/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <chrono>
+#include <algorithm>
+
+namespace Jimmy
+{
+
+//令牌桶,每秒补充 rate 个令牌,最多积累 burst 个,每条消息消耗一个
+//不加锁,由使用者保证同一时刻只在一个线程上访问
+class TokenBucket
+{
+public:
+    TokenBucket() = default;
+
+    //rate 为 0 表示不限制,burst 为 0 时与 rate 相同
+    void reset(size_t rate, size_t burst, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now())
+    {
+        rate_ = static_cast<double>(rate);
+        capacity_ = static_cast<double>((burst == 0) ? rate : burst);
+        tokens_ = capacity_;
+        last_ = now;
+    }
+
+    bool enabled() const { return rate_ > 0; }
+
+    bool consume()
+    {
+        return consume(std::chrono::steady_clock::now());
+    }
+
+    //由调用者给出当前时间
+    bool consume(std::chrono::steady_clock::time_point now)
+    {
+        if (!enabled())
+        {
+            return true;
+        }
+
+        tokens_ = std::min(capacity_, tokens_ + std::chrono::duration<double>(now - last_).count() * rate_);
+        last_ = now;
+
+        if (tokens_ < 1.0)
+        {
+            return false;
+        }
+
+        tokens_ -= 1.0;
+        return true;
+    }
+private:
+    double rate_{0};
+    double capacity_{0};
+    double tokens_{0};
+    std::chrono::steady_clock::time_point last_;
+};
+
+}
@@ -0,0 +1,108 @@
+﻿#pragma once
+/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+namespace Jimmy
+{
+
+//写优先的读写锁,满足 SharedMutex 要求,可用于 std::lock_guard 和 std::shared_lock
+//有写者等待时新的读者不再进入,持续不断的读锁不会让写者饿死
+//没有写者时读锁只比 std::shared_mutex 多读一次原子计数
+//不可重入:持有读锁的线程再次加读锁时,如果期间有写者在等待会死锁
+class WriterPreferringMutex
+{
+public:
+    WriterPreferringMutex() = default;
+    WriterPreferringMutex(const WriterPreferringMutex&) = delete;
+    WriterPreferringMutex& operator=(const WriterPreferringMutex&) = delete;
+
+    //写者先登记再排队,登记后新的读者在 writerGate_ 上等待,已持有读锁的读者释放后写者进入
+    void lock()
+    {
+        ++waitingWriters_;
+        writerGate_.lock();
+        mutex_.lock();
+    }
+
+    bool try_lock()
+    {
+        if (!writerGate_.try_lock())
+        {
+            return false;
+        }
+
+        if (!mutex_.try_lock())
+        {
+            writerGate_.unlock();
+            return false;
+        }
+
+        ++waitingWriters_;
+        return true;
+    }
+
+    void unlock()
+    {
+        mutex_.unlock();
+        --waitingWriters_;
+        writerGate_.unlock();
+    }
+
+    void lock_shared()
+    {
+        //有写者登记时等它释放 writerGate_,不自旋
+        if (waitingWriters_ > 0)
+        {
+            std::lock_guard<std::mutex> lg(writerGate_);
+        }
+
+        mutex_.lock_shared();
+    }
+
+    bool try_lock_shared()
+    {
+        if (waitingWriters_ > 0)
+        {
+            return false;
+        }
+
+        return mutex_.try_lock_shared();
+    }
+
+    void unlock_shared()
+    {
+        mutex_.unlock_shared();
+    }
+private:
+    std::shared_mutex mutex_;
+    std::mutex writerGate_;                     //写者排队,持有写锁期间一直持有
+    std::atomic<size_t> waitingWriters_{0};     //已登记(等待或持有写锁)的写者数
+};
+
+}
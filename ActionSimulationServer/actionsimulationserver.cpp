@@ -27,12 +27,19 @@ SOFTWARE.
 #include "appconfig.h"
 #include "projectmanager.h"
 #include "usermanager.h"
+#include "multicastpublisher.h"
+#include "commonfunction.h"
+#include "messagecodec.h"
 
 using namespace std;
 using namespace Jimmy;
 
 ActionSimulationServer gActionSimulationServer;
 
+ActionSimulationServer::ActionSimulationServer() = default;
+
+ActionSimulationServer::~ActionSimulationServer() = default;
+
 ActionSimulationService::ActionSimulationService(int argc, char **argv)
     : QtService<QCoreApplication>(argc, argv, gActionSimulationServer.getAppConfig()->getServiceName())
 {
@@ -42,7 +49,10 @@ ActionSimulationService::ActionSimulationService(int argc, char **argv)
 
 void ActionSimulationService::start()
 {
-    gActionSimulationServer.start();
+    if (!gActionSimulationServer.start())
+    {
+        application()->exit(-1);
+    }
 }
 
 void ActionSimulationService::stop()
@@ -62,9 +72,26 @@ bool ActionSimulationServer::loadConfiguration()
 
 bool ActionSimulationServer::initializeSystemConfig()
 {
+    QString error;
+    if (!IoContextPool::checkBackend(error))
+    {
+        LOGERROR(QStringLiteral("[%1:%2] network backend %3 is unavailable: %4")
+            .arg(__FUNCTION__)
+            .arg(__LINE__)
+            .arg(IoContextPool::backendName())
+            .arg(error));
+
+        return false;
+    }
+
+    LOGINFO(QStringLiteral("[%1:%2] network backend %3")
+        .arg(__FUNCTION__)
+        .arg(__LINE__)
+        .arg(IoContextPool::backendName()));
+
     if (!tcpServer_)
     {
-        tcpServer_ = make_unique<TcpServer>();
+        tcpServer_ = make_unique<TcpServer>(appConfig_->getNetworkOption());
     }
 
     if (!userManager_)
@@ -77,10 +104,53 @@ bool ActionSimulationServer::initializeSystemConfig()
         projectManager_ = make_shared<ProjectManager>();
     }
 
-    boost::asio::ip::address addr;
-    addr.from_string(appConfig_->getListenAddress().toStdString());
+    //连接创建时即取得组包回调,必须在 start 之前注册
+    tcpServer_->registerMessageProcessFunction(std::bind(&ProjectManager::pushMessage, projectManager_.get(), placeholders::_1, placeholders::_2));
+    tcpServer_->registerAppendConnnection(std::bind(&UserManager::registerConnection, userManager_.get(), placeholders::_1));
+    tcpServer_->registerRemoveConnnection(std::bind(&ActionSimulationServer::removeConnection_, this, placeholders::_1));
+    tcpServer_->registerResyncFunction(std::bind(&ProjectManager::resyncConnection, projectManager_.get(), placeholders::_1));
+    tcpServer_->registerBlacklistFunction(std::bind(&ActionSimulationServer::blacklistConnection, this, placeholders::_1));
+
+    if (appConfig_->getMulticastOption().enable && !multicastPublisher_)
+    {
+        auto multicastPublisher = make_unique<MulticastPublisher>();
+        if (!multicastPublisher->start(appConfig_->getMulticastOption()))
+        {
+            return false;
+        }
+
+        multicastPublisher_ = std::move(multicastPublisher);
+    }
+
+    boost::system::error_code ec;
+    auto addr = boost::asio::ip::make_address(appConfig_->getListenAddress().toStdString(), ec);
+    if (ec)
+    {
+        LOGERROR(QStringLiteral("[%1:%2] listen address %3 is invalid: %4")
+            .arg(__FUNCTION__)
+            .arg(__LINE__)
+            .arg(appConfig_->getListenAddress())
+            .arg(CommonFunction::GBKtoUTF8(ec.message()).c_str()));
+
+        return false;
+    }
+
     boost::asio::ip::tcp::endpoint ep(addr, appConfig_->getListenPort());
-    tcpServer_->start(ep);
+    if (!tcpServer_->start(ep))
+    {
+        LOGERROR(QStringLiteral("[%1:%2] start listener %3:%4 failed")
+            .arg(__FUNCTION__)
+            .arg(__LINE__)
+            .arg(appConfig_->getListenAddress())
+            .arg(appConfig_->getListenPort()));
+
+        return false;
+    }
+
+    if (!startAdminServer())
+    {
+        return false;
+    }
 
     if(projectManager_->getStatus() == ProjectStatus::stopped)
     {
@@ -88,34 +158,320 @@ bool ActionSimulationServer::initializeSystemConfig()
         projectManager_->run();
     }
 
-    tcpServer_->registerMessageProcessFunction(std::bind(&ProjectManager::pushMessage, projectManager_.get(), placeholders::_1, placeholders::_2));
-    tcpServer_->registerAppendConnnection(std::bind(&UserManager::registerConnection, userManager_.get(), placeholders::_1));
-    tcpServer_->registerRemoveConnnection(std::bind(&UserManager::disconnect, userManager_.get(), placeholders::_1));
+    return true;
+}
+
+bool ActionSimulationServer::startAdminServer()
+{
+    if (appConfig_->getAdminPort() == 0)
+    {
+        return true;
+    }
+
+    if (!adminServer_)
+    {
+        //控制命令数量很少,一个 io 线程即可,与数据端口的 io 线程互不影响
+        auto option = appConfig_->getNetworkOption();
+        option.ioContextCount = 1;
+        option.acceptorCount = 1;
+        option.unixSocketPath.clear();
+        adminServer_ = make_unique<TcpServer>(option);
+    }
+
+    adminServer_->registerMessageProcessFunction(std::bind(&ProjectManager::pushControlMessage, projectManager_.get(), placeholders::_1, placeholders::_2));
+    adminServer_->registerAppendConnnection([this](size_t connectionid)
+    {
+        {
+            lock_guard<shared_mutex> lg(lockConnections_);
+            adminConnections_.insert(connectionid);
+        }
+
+        return userManager_->registerConnection(connectionid);
+    });
+    adminServer_->registerRemoveConnnection(std::bind(&ActionSimulationServer::removeConnection_, this, placeholders::_1));
+    adminServer_->registerResyncFunction(std::bind(&ProjectManager::resyncConnection, projectManager_.get(), placeholders::_1));
+    adminServer_->registerBlacklistFunction(std::bind(&ActionSimulationServer::blacklistConnection, this, placeholders::_1));
+
+    boost::system::error_code ec;
+    auto addr = boost::asio::ip::make_address(appConfig_->getAdminAddress().toStdString(), ec);
+    if (ec)
+    {
+        LOGERROR(QStringLiteral("[%1:%2] admin address %3 is invalid: %4")
+            .arg(__FUNCTION__)
+            .arg(__LINE__)
+            .arg(appConfig_->getAdminAddress())
+            .arg(CommonFunction::GBKtoUTF8(ec.message()).c_str()));
+
+        return false;
+    }
+
+    boost::asio::ip::tcp::endpoint ep(addr, appConfig_->getAdminPort());
+    if (!adminServer_->start(ep))
+    {
+        LOGERROR(QStringLiteral("[%1:%2] start admin listener %3:%4 failed")
+            .arg(__FUNCTION__)
+            .arg(__LINE__)
+            .arg(appConfig_->getAdminAddress())
+            .arg(appConfig_->getAdminPort()));
+
+        return false;
+    }
 
     return true;
 }
 
+void ActionSimulationServer::blacklistConnection(size_t connectionid)
+{
+    //连接随后由 TcpServer 断开,ban_time 大于 0 时 TcpServer 已记录对端地址并在该时间内拒绝其新连接
+    auto userInfo = userManager_->getUserInfo(Connection{connectionid});
+    LOGWARN(QStringLiteral("[%1:%2] connection %3 of user %4 exceeded ingress rate and was kicked, banned for %5 seconds")
+        .arg(__FUNCTION__)
+        .arg(__LINE__)
+        .arg(connectionid)
+        .arg(userInfo ? userInfo->userId.userID : 0)
+        .arg(appConfig_->getNetworkOption().banTime));
+}
+
+bool ActionSimulationServer::isAdminConnection_(size_t connectionid)
+{
+    shared_lock<shared_mutex> lg(lockConnections_);
+    return adminConnections_.contains(connectionid);
+}
+
+void ActionSimulationServer::removeConnection_(size_t connectionid)
+{
+    {
+        lock_guard<shared_mutex> lg(lockConnections_);
+        adminConnections_.remove(connectionid);
+        cborConnections_.remove(connectionid);
+    }
+
+    userManager_->disconnect(connectionid);
+}
+
+bool ActionSimulationServer::isGatewayAllowed(size_t connectionid)
+{
+    //AF_UNIX 连接没有 IP 地址,能否连接由套接字文件的权限控制
+    if (tcpServer_->isLocal(connectionid))
+    {
+        return appConfig_->getGatewayUnixSocket();
+    }
+
+    //管理端口的连接不在 tcpServer_ 中,同样返回 false
+    boost::asio::ip::address address;
+    if (!tcpServer_->getRemoteAddress(connectionid, address))
+    {
+        return false;
+    }
+
+    return appConfig_->getGatewayAddresses().contains(QString::fromStdString(address.to_string()));
+}
+
+bool ActionSimulationServer::supportCodec(size_t connectionid, const QString& codec)
+{
+    if (codec == QStringLiteral("json"))
+    {
+        return true;
+    }
+
+    if (codec != QStringLiteral("cbor"))
+    {
+        return false;
+    }
+
+    //cbor 是二进制,只能放在长度前缀的帧里,分隔符分帧的连接无法区分消息边界
+    if (adminServer_ && isAdminConnection_(connectionid))
+    {
+        return adminServer_->isLengthPrefix(connectionid);
+    }
+
+    return tcpServer_->isLengthPrefix(connectionid);
+}
+
+void ActionSimulationServer::setConnectionCodec(size_t connectionid, const QString& codec)
+{
+    lock_guard<shared_mutex> lg(lockConnections_);
+    if (codec == QStringLiteral("cbor"))
+    {
+        cborConnections_.insert(connectionid);
+    }
+    else
+    {
+        cborConnections_.remove(connectionid);
+    }
+}
+
+QString ActionSimulationServer::getConnectionCodec(size_t connectionid)
+{
+    shared_lock<shared_mutex> lg(lockConnections_);
+    return cborConnections_.contains(connectionid) ? QStringLiteral("cbor") : QStringLiteral("json");
+}
+
 void ActionSimulationServer::releaseSystemConfig()
 {
-    userManager_->clear();
+    //初始化失败时各模块可能尚未创建
+    if (userManager_)
+    {
+        userManager_->clear();
+    }
 
-    if (projectManager_->getStatus() == ProjectStatus::running)
+    if (projectManager_ && (projectManager_->getStatus() == ProjectStatus::running))
     {
         projectManager_->stop();
     }
 
-    tcpServer_->stop();
+    if (adminServer_)
+    {
+        adminServer_->stop();
+    }
+
+    if (tcpServer_)
+    {
+        tcpServer_->stop();
+    }
+
+    if (multicastPublisher_)
+    {
+        multicastPublisher_->stop();
+        multicastPublisher_.reset();
+    }
 }
 
-void ActionSimulationServer::sendNetMessage(size_t connectionid, const QString& message)
+void ActionSimulationServer::sendNetMessage(size_t connectionid, const QJsonObject& message, const QString& conflateKey)
 {
     if (connectionid == 0)
     {
-        LOGINFO(message);
+        LOGINFO(QString::fromUtf8(MessageCodec::toJson(message)));
+        return;
+    }
+
+    bool isAdmin = false;
+    bool isCbor = false;
+    {
+        shared_lock<shared_mutex> lg(lockConnections_);
+        isAdmin = adminConnections_.contains(connectionid);
+        isCbor = cborConnections_.contains(connectionid);
+    }
+
+    QByteArray data = isCbor ? MessageCodec::toCbor(message) : MessageCodec::toJson(message);
+    if (adminServer_ && isAdmin)
+    {
+        adminServer_->sendData(connectionid,data,conflateKey);
+        return;
+    }
+
+    tcpServer_->sendData(connectionid,data,conflateKey);
+}
+
+void ActionSimulationServer::sendNetMessage(const QVector<size_t>& connectionids, const QJsonObject& message, const QString& conflateKey)
+{
+    if (connectionids.isEmpty())
+    {
+        return;
+    }
+
+    //按编码和所属 TcpServer 分组,每种编码只编码一次
+    bool hasLog = false;
+    QVector<size_t> vConnection;
+    QVector<size_t> vAdminConnection;
+    QVector<size_t> vCborConnection;
+    QVector<size_t> vCborAdminConnection;
+    vConnection.reserve(connectionids.size());
+    {
+        shared_lock<shared_mutex> lg(lockConnections_);
+        foreach (auto connectionid, connectionids)
+        {
+            if (connectionid == 0)
+            {
+                hasLog = true;
+                continue;
+            }
+
+            bool isCbor = cborConnections_.contains(connectionid);
+            if (adminConnections_.contains(connectionid))
+            {
+                (isCbor ? vCborAdminConnection : vAdminConnection).push_back(connectionid);
+                continue;
+            }
+
+            (isCbor ? vCborConnection : vConnection).push_back(connectionid);
+        }
+    }
+
+    if (!vConnection.isEmpty() || !vAdminConnection.isEmpty() || hasLog)
+    {
+        QByteArray data = MessageCodec::toJson(message);
+        if (hasLog)
+        {
+            LOGINFO(QString::fromUtf8(data));
+        }
+
+        if (!vConnection.isEmpty())
+        {
+            tcpServer_->sendData(vConnection,data,conflateKey);
+        }
+
+        if (!vAdminConnection.isEmpty() && adminServer_)
+        {
+            adminServer_->sendData(vAdminConnection,data,conflateKey);
+        }
+    }
+
+    if (!vCborConnection.isEmpty() || !vCborAdminConnection.isEmpty())
+    {
+        QByteArray data = MessageCodec::toCbor(message);
+        if (!vCborConnection.isEmpty())
+        {
+            tcpServer_->sendData(vCborConnection,data,conflateKey);
+        }
+
+        if (!vCborAdminConnection.isEmpty() && adminServer_)
+        {
+            adminServer_->sendData(vCborAdminConnection,data,conflateKey);
+        }
+    }
+}
+
+QVector<Jimmy::ConnectionStatus> ActionSimulationServer::getConnectionStatus()
+{
+    auto vStatus = tcpServer_->getConnectionStatus();
+    if (adminServer_)
+    {
+        vStatus += adminServer_->getConnectionStatus();
+    }
+
+    return vStatus;
+}
+
+void ActionSimulationServer::setConnectionLogin(size_t connectionid)
+{
+    if (adminServer_ && isAdminConnection_(connectionid))
+    {
+        adminServer_->setLogin(connectionid);
         return;
     }
 
-    tcpServer_->sendData(connectionid,message.toLocal8Bit());
+    tcpServer_->setLogin(connectionid);
+}
+
+void ActionSimulationServer::multicastComponentChange(Jimmy::User userid, const QString& cid, const QJsonValue& value)
+{
+    if (multicastPublisher_)
+    {
+        multicastPublisher_->publish(userid, cid, value);
+    }
+}
+
+bool ActionSimulationServer::snapshotMulticast(Jimmy::User userid, const std::function<void()>& snapshot, uint64_t& seq)
+{
+    if (multicastPublisher_)
+    {
+        seq = multicastPublisher_->snapshot(userid, snapshot);
+        return true;
+    }
+
+    snapshot();
+    return false;
 }
 
 void ActionSimulationServer::registerAppendConnnection(std::function<Jimmy::User(size_t)> connection)
@@ -148,9 +504,9 @@ std::shared_ptr<UserManager> ActionSimulationServer::getUserManager()
     return userManager_;
 }
 
-void ActionSimulationServer::start()
+bool ActionSimulationServer::start()
 {
-    initializeSystemConfig();
+    return initializeSystemConfig();
 }
 
 void ActionSimulationServer::stop()
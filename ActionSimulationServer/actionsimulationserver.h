@@ -26,6 +26,10 @@ SOFTWARE.
 ******************************************************************************/
 
 #include <QCoreApplication>
+#include <QJsonValue>
+#include <QJsonObject>
+#include <QSet>
+#include <shared_mutex>
 #include "qtservice.h"
 #include "tcpserver.h"
 
@@ -42,12 +46,13 @@ protected:
 class AppConfig;
 class ProjectManager;
 class UserManager;
+class MulticastPublisher;
 
 class ActionSimulationServer
 {
 public:
-    ActionSimulationServer() = default;
-    ~ActionSimulationServer() = default;
+    ActionSimulationServer();
+    ~ActionSimulationServer();
 
    bool loadConfiguration();
 
@@ -56,22 +61,54 @@ public:
 
    void registerMessageProcessFunction(std::function<void(size_t, const std::string&)> messageProcess);
 
-   void sendNetMessage(size_t connectionid, const QString& message);
+   //消息在这里按连接协商的编码序列化
+   void sendNetMessage(size_t connectionid, const QJsonObject& message, const QString& conflateKey = QString());
+   //每种编码只序列化一次,编码后的数据由使用该编码的所有连接共享
+   void sendNetMessage(const QVector<size_t>& connectionids, const QJsonObject& message, const QString& conflateKey = QString());
+
+   QVector<Jimmy::ConnectionStatus> getConnectionStatus();
+   void setConnectionLogin(size_t connectionid);
+
+   //登录时协商的编码,json 总是支持,cbor 需要连接使用长度前缀分帧
+   bool supportCodec(size_t connectionid, const QString& codec);
+   void setConnectionCodec(size_t connectionid, const QString& codec);
+   QString getConnectionCodec(size_t connectionid);
+
+   //数据端口上对端地址在 gateway_addresses 中的连接才能作为网关登录,AF_UNIX 连接由 gateway_unix_socket 决定
+   bool isGatewayAllowed(size_t connectionid);
+
+   //输出组件值变化时发送组播,未启用组播时直接返回
+   void multicastComponentChange(Jimmy::User userid, const QString& cid, const QJsonValue& value);
+   //在该用户的组播发布锁内执行 snapshot 并取得当前序号,未启用组播时直接执行并返回 false
+   bool snapshotMulticast(Jimmy::User userid, const std::function<void()>& snapshot, uint64_t& seq);
 
    std::shared_ptr<AppConfig> getAppConfig();
    std::shared_ptr<ProjectManager> getProjectManager();
    std::shared_ptr<UserManager> getUserManager();
 
-   void start();
+   bool start();
    void stop();
 private:
     bool initializeSystemConfig();
     void releaseSystemConfig();
+
+    bool startAdminServer();
+    bool isAdminConnection_(size_t connectionid);
+    void blacklistConnection(size_t connectionid);
+    void removeConnection_(size_t connectionid);
 private:
     std::shared_ptr<AppConfig> appConfig_;
     std::shared_ptr<ProjectManager> projectManager_;
     std::shared_ptr<UserManager> userManager_;
     std::unique_ptr<Jimmy::TcpServer> tcpServer_;
+    std::unique_ptr<MulticastPublisher> multicastPublisher_;
+
+    //管理端口使用独立的 TcpServer,连接号全局唯一,按连接号区分发往哪个 TcpServer
+    std::unique_ptr<Jimmy::TcpServer> adminServer_;
+    QSet<size_t> adminConnections_;
+    //协商为 cbor 的连接,未列入的连接使用 json
+    QSet<size_t> cborConnections_;
+    std::shared_mutex lockConnections_;
 };
 
 extern ActionSimulationServer gActionSimulationServer;
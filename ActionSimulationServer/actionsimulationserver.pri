@@ -0,0 +1,47 @@
+# ActionSimulationServer 和 epoll 版本共用的源文件和依赖
+
+include($$PWD/../ActionSimulationBase/actionsimulationbase.pri)
+include($$PWD/qtservice/src/qtservice.pri)
+
+INCLUDEPATH += D:/Labraries/boost_1_80_0  \
+               D:/Labraries//LuaJIT-2.1.0-beta3/src  \
+               $$PWD/../ActionSimulationBase \
+
+LIBS += D:/Labraries/LuaJIT-2.1.0-beta3/src/lua51.lib  \
+
+QMAKE_LFLAGS   = /NODEFAULTLIB:libcmt.lib
+
+DEFINES += _WIN32_WINNT=0x0601
+
+SOURCES += \
+        $$PWD/actionscript.cpp \
+        $$PWD/actionsimulationserver.cpp \
+        $$PWD/appconfig.cpp \
+        $$PWD/boardcast.cpp \
+        $$PWD/corecomponent.cpp \
+        $$PWD/inputcomponent.cpp \
+        $$PWD/main.cpp \
+        $$PWD/multicastpublisher.cpp \
+        $$PWD/normalcomponent.cpp \
+        $$PWD/projectmanager.cpp \
+        $$PWD/scheduledtaskpool.cpp \
+        $$PWD/teammastercomponent.cpp \
+        $$PWD/teamslavecomponent.cpp \
+        $$PWD/threadpool.cpp \
+        $$PWD/usermanager.cpp
+
+HEADERS += \
+    $$PWD/actionscript.h \
+    $$PWD/actionsimulationserver.h \
+    $$PWD/appconfig.h \
+    $$PWD/boardcast.h \
+    $$PWD/corecomponent.h \
+    $$PWD/inputcomponent.h \
+    $$PWD/multicastpublisher.h \
+    $$PWD/normalcomponent.h \
+    $$PWD/projectmanager.h \
+    $$PWD/scheduledtaskpool.h \
+    $$PWD/teammastercomponent.h \
+    $$PWD/teamslavecomponent.h \
+    $$PWD/threadpool.h \
+    $$PWD/usermanager.h
@@ -30,6 +30,7 @@ SOFTWARE.
 #include <QJsonDocument>
 #include <QJsonValue>
 #include <QJsonObject>
+#include <QJsonArray>
 #include "actionsimulationserver.h"
 #include "appconfig.h"
 #include "commonfunction.h"
@@ -84,6 +85,126 @@ ErrorCode getFileNameWithExt(const string& ExtName, string& out_filename)
     return ec_ok;
 }
 
+//读取可选的非负整数配置项,不存在时保持原值
+bool readOptionalNumber(const QJsonObject& jo, const QString& key, size_t& value)
+{
+    auto itor = jo.find(key);
+    if (itor == jo.end())
+    {
+        return true;
+    }
+
+    if ((!itor->isDouble()) || (itor->toDouble() < 0))
+    {
+        return false;
+    }
+
+    value = static_cast<size_t>(itor->toDouble());
+    return true;
+}
+
+//读取可选的布尔配置项,不存在时保持原值
+bool readOptionalBool(const QJsonObject& jo, const QString& key, bool& value)
+{
+    auto itor = jo.find(key);
+    if (itor == jo.end())
+    {
+        return true;
+    }
+
+    if (!itor->isBool())
+    {
+        return false;
+    }
+
+    value = itor->toBool();
+    return true;
+}
+
+//读取可选的字符串配置项,不存在时保持原值
+bool readOptionalString(const QJsonObject& jo, const QString& key, std::string& value)
+{
+    auto itor = jo.find(key);
+    if (itor == jo.end())
+    {
+        return true;
+    }
+
+    if (!itor->isString())
+    {
+        return false;
+    }
+
+    value = itor->toString().toStdString();
+    return true;
+}
+
+//读取可选的发送队列超限策略,不存在时保持原值
+bool readOptionalPolicy(const QJsonObject& jo, const QString& key, OverflowPolicy& policy)
+{
+    auto itor = jo.find(key);
+    if (itor == jo.end())
+    {
+        return true;
+    }
+
+    if (!itor->isString())
+    {
+        return false;
+    }
+
+    QString value = itor->toString();
+    if (value == "disconnect")
+    {
+        policy = OverflowPolicy::Disconnect;
+    }
+    else if (value == "drop_oldest")
+    {
+        policy = OverflowPolicy::DropOldest;
+    }
+    else if (value == "resync")
+    {
+        policy = OverflowPolicy::Resync;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+//读取可选的 IP 地址数组,地址统一转换为 make_address 的标准写法,不存在时保持原值
+bool readOptionalAddresses(const QJsonObject& jo, const QString& key, QSet<QString>& addresses)
+{
+    auto itor = jo.find(key);
+    if (itor == jo.end())
+    {
+        return true;
+    }
+
+    if (!itor->isArray())
+    {
+        return false;
+    }
+
+    QSet<QString> values;
+    foreach (auto item, itor->toArray())
+    {
+        boost::system::error_code ec;
+        auto address = boost::asio::ip::make_address(item.toString().toStdString(), ec);
+        if ((!item.isString()) || ec)
+        {
+            return false;
+        }
+
+        values.insert(QString::fromStdString(address.to_string()));
+    }
+
+    addresses = values;
+    return true;
+}
+
 void AppConfig::clearLogs()
 {
     QFileInfo logFile(GlobalLogger::get_instance()->getLogFile());
@@ -114,6 +235,12 @@ void AppConfig::clearLogs()
 AppConfig::AppConfig()
     :isRun_(false)
     , port_(0)
+    , adminAddress_("127.0.0.1")
+    , adminPort_(0)
+    , commandThreadCount_(0)
+    , userIngressRate_(0)
+    , userIngressBurst_(0)
+    , gatewayUnixSocket_(false)
     , logRetainDays_(15)
     , logLevel_(LogLevel::LL_INFO)
 {
@@ -278,6 +405,230 @@ bool AppConfig::loadConfiguration(const QString& fileName)
         }
     }
 
+    memItor = docObj.find("admin");
+    if(memItor != docObj.end())
+    {
+        if(!memItor->isObject())
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key admin is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        memElem = memItor->toObject();
+        std::string address = adminAddress_.toStdString();
+        size_t port = adminPort_;
+        if((!readOptionalString(memElem, "address", address))
+            || (!readOptionalNumber(memElem, "port", port))
+            || (port > 65535)
+            || ((port != 0) && (port == port_)))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key admin address or port is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        adminAddress_ = QString::fromStdString(address);
+        adminPort_ = static_cast<uint16_t>(port);
+    }
+
+    memItor = docObj.find("network");
+    if(memItor != docObj.end())
+    {
+        if(!memItor->isObject())
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        memElem = memItor->toObject();
+        if(!readOptionalNumber(memElem, "io_threads", networkOption_.ioContextCount))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network io_threads is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if((!readOptionalNumber(memElem, "acceptors", networkOption_.acceptorCount))
+            || (networkOption_.acceptorCount == 0))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network acceptors is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if(!readOptionalNumber(memElem, "write_batch_window", networkOption_.writeBatchWindow))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network write_batch_window is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if((!readOptionalNumber(memElem, "write_queue_max_messages", networkOption_.writeQueueMaxMessages))
+            || (!readOptionalPolicy(memElem, "write_queue_message_policy", networkOption_.messageOverflowPolicy)))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network write_queue_max_messages or write_queue_message_policy is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if((!readOptionalNumber(memElem, "write_queue_max_bytes", networkOption_.writeQueueMaxBytes))
+            || (!readOptionalPolicy(memElem, "write_queue_byte_policy", networkOption_.byteOverflowPolicy)))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network write_queue_max_bytes or write_queue_byte_policy is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if(!readOptionalBool(memElem, "conflate_output", networkOption_.conflateOutput))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network conflate_output is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if(!readOptionalNumber(memElem, "zero_copy_threshold", networkOption_.zeroCopyThreshold))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network zero_copy_threshold is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if((!readOptionalNumber(memElem, "idle_timeout", networkOption_.idleTimeout))
+            || (!readOptionalNumber(memElem, "login_timeout", networkOption_.loginTimeout)))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network idle_timeout or login_timeout is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if(!readOptionalString(memElem, "unix_socket", networkOption_.unixSocketPath))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network unix_socket is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if((!readOptionalNumber(memElem, "ingress_rate", networkOption_.ingressRate))
+            || (!readOptionalNumber(memElem, "ingress_burst", networkOption_.ingressBurst))
+            || (!readOptionalNumber(memElem, "ingress_kick_threshold", networkOption_.ingressKickThreshold)))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network ingress_rate, ingress_burst or ingress_kick_threshold is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if(!readOptionalNumber(memElem, "command_threads", commandThreadCount_))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network command_threads is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if(!readOptionalNumber(memElem, "ban_time", networkOption_.banTime))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network ban_time is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if(!readOptionalAddresses(memElem, "gateway_addresses", gatewayAddresses_))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network gateway_addresses is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if(!readOptionalBool(memElem, "gateway_unix_socket", gatewayUnixSocket_))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network gateway_unix_socket is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        if((!readOptionalNumber(memElem, "user_ingress_rate", userIngressRate_))
+            || (!readOptionalNumber(memElem, "user_ingress_burst", userIngressBurst_)))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key network user_ingress_rate or user_ingress_burst is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+    }
+
+    memItor = docObj.find("multicast");
+    if(memItor != docObj.end())
+    {
+        if(!memItor->isObject())
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key multicast is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        memElem = memItor->toObject();
+        std::string address = multicastOption_.address.toStdString();
+        std::string interfaceAddress = multicastOption_.interfaceAddress.toStdString();
+        size_t port = multicastOption_.port;
+        if((!readOptionalBool(memElem, "enable", multicastOption_.enable))
+            || (!readOptionalString(memElem, "address", address))
+            || (!readOptionalNumber(memElem, "port", port))
+            || (port == 0) || (port > 65535)
+            || (!readOptionalNumber(memElem, "ttl", multicastOption_.ttl))
+            || (multicastOption_.ttl > 255)
+            || (!readOptionalString(memElem, "interface", interfaceAddress))
+            || (!readOptionalBool(memElem, "loopback", multicastOption_.loopback)))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] key multicast is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return false;
+        }
+
+        multicastOption_.address = QString::fromStdString(address);
+        multicastOption_.interfaceAddress = QString::fromStdString(interfaceAddress);
+        multicastOption_.port = static_cast<uint16_t>(port);
+    }
+
     memItor = docObj.find("miscellaneous");
     if((memItor == docObj.end())||(!memItor->isObject()))
     {
@@ -30,8 +30,11 @@ SOFTWARE.
 #include <QString>
 #include <QFileInfo>
 #include <QDir>
+#include <QSet>
 #include "commonconst.h"
 #include "logger.h"
+#include "tcpserver.h"
+#include "multicastpublisher.h"
 
 class AppConfig
 {
@@ -57,6 +60,33 @@ public:
     //获取监听端口
     uint16_t getListenPort() { return port_; }
 
+    //获取管理端口监听地址
+    const QString& getAdminAddress() { return adminAddress_; }
+
+    //获取管理端口,0 表示不启用
+    uint16_t getAdminPort() { return adminPort_; }
+
+    //获取网络配置
+    const Jimmy::TcpServerOption& getNetworkOption() { return networkOption_; }
+
+    //获取每个用户每秒最多接收的消息数,0 表示不限制
+    size_t getUserIngressRate() { return userIngressRate_; }
+
+    //获取每个用户允许的突发消息数,0 表示与 getUserIngressRate 相同
+    size_t getUserIngressBurst() { return userIngressBurst_; }
+
+    //获取允许作为网关登录的客户端 IP 地址,为空时不允许网关
+    const QSet<QString>& getGatewayAddresses() { return gatewayAddresses_; }
+
+    //获取 AF_UNIX 连接是否可以作为网关登录
+    bool getGatewayUnixSocket() { return gatewayUnixSocket_; }
+
+    //获取处理数据命令的线程数,0 表示与 CPU 核数相同
+    size_t getCommandThreadCount() { return commandThreadCount_; }
+
+    //获取组播输出配置
+    const MulticastOption& getMulticastOption() { return multicastOption_; }
+
     //获取日志保存天数
     uint32_t getLogRetainDays() { return logRetainDays_; }
 
@@ -80,6 +110,18 @@ private:
     QString address_;
     uint16_t port_;
 
+    QString adminAddress_;
+    uint16_t adminPort_;
+
+    Jimmy::TcpServerOption networkOption_;
+    MulticastOption multicastOption_;
+
+    size_t commandThreadCount_;
+    size_t userIngressRate_;
+    size_t userIngressBurst_;
+    QSet<QString> gatewayAddresses_;
+    bool gatewayUnixSocket_;
+
     uint32_t logRetainDays_;
     Jimmy::LogLevel logLevel_;
 };
@@ -224,12 +224,20 @@ std::optional<ScheduledTask> CoreComponent::analysisTimerbase(User userid,const
     return st;
 }
 
-QString CoreComponent::getAnswerValue(const QJsonValue& value)
+AnswerValue CoreComponent::getAnswerValue(const QJsonValue& value)
 {
-    QJsonObject jo;
-    jo.insert("cid", getID());
-    jo.insert("value", value);
-    return QJsonDocument(jo).toJson(QJsonDocument::Compact);
+    return makeAnswerValue(getID(), getHandle(), value);
+}
+
+AnswerValue CoreComponent::makeAnswerValue(const QString& cid, int handle, const QJsonValue& value)
+{
+    AnswerValue answer;
+    answer.message.insert("cid", cid);
+    answer.message.insert("value", value);
+    answer.handle = handle;
+    answer.value = value;
+
+    return answer;
 }
 
 
@@ -18,6 +18,24 @@ struct UserValue
     QJsonValue          cache;
 };
 
+//组件值消息在组件处生成 cid 形式,句柄形式只在确有连接请求了句柄时由 UserManager 生成
+struct AnswerValue
+{
+    QJsonObject message;                        //{"cid":%s,"value":%r}
+    int         handle{-1};                     //组件没有句柄时为 -1
+    QJsonValue  value;
+
+    bool hasHandle() const { return handle >= 0; }
+    //{"h":%d,"v":%r}
+    QJsonObject handleMessage() const
+    {
+        QJsonObject obj;
+        obj.insert("h", handle);
+        obj.insert("v", value);
+        return obj;
+    }
+};
+
 class CoreComponent
 {
 public:
@@ -32,6 +50,10 @@ public:
 
     QString getID() const { return id_; }
 
+    //加载项目时按顺序分配的句柄,从 0 开始连续编号,客户端可用句柄代替 cid
+    int getHandle() const { return handle_; }
+    void setHandle(int handle) { handle_ = handle; }
+
 
     virtual ErrorCode start() = 0;
     virtual void stop() = 0;
@@ -42,6 +64,11 @@ public:
     virtual ErrorCode load(const QString& id,const QJsonObject& jo) = 0;
     virtual void onTime(User userid,size_t counter) = 0;
     virtual void onAction(User userid,const QString& trigger,const QJsonValue& value) = 0;
+    //batch 合并的多个触发来源,trigger / value 为最后一个来源;不使用脚本的组件按最后一个来源处理
+    virtual void onBatchAction(User userid,const QJsonObject& /*triggers*/,const QString& trigger,const QJsonValue& value)
+    {
+        onAction(userid,trigger,value);
+    }
     virtual void onBoardcast(User userid) = 0;
     virtual void onLoop(User userid,const QJsonValue& value) = 0;
     virtual void removeUser(User userid) = 0;
@@ -49,7 +76,8 @@ public:
     virtual QStringList getSubscription() const = 0;
     virtual QStringList getRespondBoardcast() const = 0;
 
-    QString getAnswerValue(const QJsonValue& value);
+    AnswerValue getAnswerValue(const QJsonValue& value);
+    static AnswerValue makeAnswerValue(const QString& cid, int handle, const QJsonValue& value);
 
     QJsonValue getDefaultValue() const { return defaultValue_; }
     void setDefaultValue(const QJsonValue& val) { defaultValue_ = val; }
@@ -62,6 +90,7 @@ protected:
 
 private:
     QString id_;   //ID
+    int handle_{-1};
     QJsonValue defaultValue_;                                                       //缺省值
 };
 
@@ -0,0 +1,12 @@
+# CONFIG+=io_uring 时同时编译的 epoll 版本,内核不支持 io_uring 时 ActionSimulationServer 切换到这个程序
+QT += core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle io_uring
+
+TARGET = ActionSimulationServer_epoll
+
+include($$PWD/../actionsimulationserver.pri)
+
+unix:!android: target.path = /opt/ActionSimulationServer/bin
+!isEmpty(target.path): INSTALLS += target
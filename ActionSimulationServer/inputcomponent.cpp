@@ -136,53 +136,50 @@ void InputComponent::setValue(Connection connection,const QJsonValue& value)
         return;
     }
 
+    //命令按连接分配到各线程,同一用户的多个连接可能同时修改该组件
+    //回复和变化通知都在值锁内发出,顺序与值的修改顺序一致
     const double minActionKeep = 0.1 ; //最小置位信号保持时间(秒)
     if (getActionKeep() > minActionKeep)
     {
-        ScheduledTask st;
-
+        lock_guard<shared_mutex> lg(lockValue_);
+        if (auto userVal = getUserValue_(userInfo->userId,true))
         {
-            lock_guard<shared_mutex> lg(lockValue_);
-            if (auto userVal = getUserValue_(userInfo->userId,true))
+            ScheduledTask st;
+            st.userid = userInfo->userId;
+            st.cid = getID();
+            st.times = (value == getDefaultValue()) ? 0 : 1;
+            st.next_tp = chrono::steady_clock::now() + chrono::milliseconds(static_cast<int>(getActionKeep() * 1000));
+            gActionSimulationServer.getProjectManager()->appendScheduledTask(st);
+            userVal->value = value;
+
+            if(st.times != 0)
             {
-                st.userid = userInfo->userId;
-                st.cid = getID();
-                st.times = (value == getDefaultValue()) ? 0 : 1;
-                st.next_tp = chrono::steady_clock::now() + chrono::milliseconds(static_cast<int>(getActionKeep() * 1000));
-                gActionSimulationServer.getProjectManager()->appendScheduledTask(st);
-                userVal->value = value;
+                gActionSimulationServer.getUserManager()->sendUserMessage(userInfo->userId,false,getAnswerValue(value),getID());
             }
         }
 
-        if(st.times != 0)
-        {
-            gActionSimulationServer.getUserManager()->sendUserMessage(userInfo->userId,false,getAnswerValue(value));
-        }
-
         return;
     }
 
+    lock_guard<shared_mutex> lg(lockValue_);
+    auto userVal = getUserValue_(userInfo->userId,true);
+    if (!userVal || userVal->value == value)
     {
-        lock_guard<shared_mutex> lg(lockValue_);
-        auto userVal = getUserValue_(userInfo->userId,true);
-        if (!userVal || userVal->value == value)
-        {
-            return;
-        }
+        return;
+    }
 
-        userVal->value = value;
+    userVal->value = value;
 
-        if(getBehavior() == BehaviorType::EqualInputIgnoreReset)
+    if(getBehavior() == BehaviorType::EqualInputIgnoreReset)
+    {
+        if(userVal->value == getDefaultValue())
         {
-            if(userVal->value == getDefaultValue())
-            {
-                gActionSimulationServer.getUserManager()->sendUserMessage(userInfo->userId,false,connection,getAnswerValue(value));
-                return;
-            }
+            gActionSimulationServer.getUserManager()->sendUserMessage(userInfo->userId,false,connection,getAnswerValue(value),getID());
+            return;
         }
     }
 
-    gActionSimulationServer.getUserManager()->sendUserMessage(userInfo->userId,false,connection,getAnswerValue(value));
+    gActionSimulationServer.getUserManager()->sendUserMessage(userInfo->userId,false,connection,getAnswerValue(value),getID());
     gActionSimulationServer.getProjectManager()->notifyComponentChange(userInfo->userId,getID(),value);
 }
 
@@ -279,7 +276,7 @@ void InputComponent::onAction(User userid,const QString& /*trigger*/,const QJson
         userValue->value = value;
     }
 
-    gActionSimulationServer.getUserManager()->sendUserMessage(userid,false,getAnswerValue(value));
+    gActionSimulationServer.getUserManager()->sendUserMessage(userid,false,getAnswerValue(value),getID());
     return;
 }
 
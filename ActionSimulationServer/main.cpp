@@ -28,11 +28,49 @@ SOFTWARE.
 #include "actionsimulationserver.h"
 #include "logger.h"
 
+#if defined(BOOST_ASIO_HAS_IO_URING_AS_DEFAULT)
+#include <QFileInfo>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include "iocontextpool.h"
+
+//内核不支持 io_uring 时用相同参数执行同目录下的 epoll 版本,成功时不返回
+static void execEpollFallback(char *argv[])
+{
+    QString error;
+    if (Jimmy::IoContextPool::checkBackend(error))
+    {
+        return;
+    }
+
+    QString exePath = QFileInfo(QStringLiteral("/proc/self/exe")).symLinkTarget();
+    QByteArray fallback = (QFileInfo(exePath).absolutePath() + QStringLiteral("/ActionSimulationServer_epoll")).toLocal8Bit();
+    LOGWARN(QStringLiteral("[%1:%2] io_uring is unavailable: %3, switch to %4")
+        .arg(__FUNCTION__)
+        .arg(__LINE__)
+        .arg(error)
+        .arg(QString::fromLocal8Bit(fallback)));
+
+    execv(fallback.constData(), argv);
+
+    LOGERROR(QStringLiteral("[%1:%2] execute %3 failed: %4")
+        .arg(__FUNCTION__)
+        .arg(__LINE__)
+        .arg(QString::fromLocal8Bit(fallback))
+        .arg(QString::fromLocal8Bit(strerror(errno))));
+}
+#endif
+
 int main(int argc, char *argv[])
 {
     QTextCodec * utf8 = QTextCodec::codecForName("utf8");
     QTextCodec::setCodecForLocale(utf8);
 
+#if defined(BOOST_ASIO_HAS_IO_URING_AS_DEFAULT)
+    execEpollFallback(argv);
+#endif
+
     if (!gActionSimulationServer.loadConfiguration())
     {
         LOGERROR(QStringLiteral("%1:%2").arg(__FILE__).arg(__LINE__));
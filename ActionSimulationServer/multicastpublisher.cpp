@@ -0,0 +1,194 @@
+﻿/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <QJsonObject>
+#include <QJsonDocument>
+#include "multicastpublisher.h"
+#include "logger.h"
+#include "commonfunction.h"
+
+using namespace std;
+using namespace Jimmy;
+
+MulticastPublisher::MulticastPublisher()
+    :socket_(ioContext_)
+    , isRun_(false)
+{
+}
+
+MulticastPublisher::~MulticastPublisher()
+{
+    stop();
+}
+
+bool MulticastPublisher::start(const MulticastOption& option)
+{
+    boost::system::error_code ec;
+    auto address = boost::asio::ip::make_address(option.address.toStdString(), ec);
+    if (ec || !address.is_multicast())
+    {
+        LOGERROR(QStringLiteral("[%1:%2] multicast address %3 is invalid")
+                 .arg(__FUNCTION__)
+                 .arg(__LINE__)
+                 .arg(option.address));
+        return false;
+    }
+
+    endpoint_ = boost::asio::ip::udp::endpoint(address, option.port);
+    socket_.open(endpoint_.protocol(), ec);
+    if (!ec)
+    {
+        socket_.set_option(boost::asio::ip::multicast::hops(static_cast<int>(option.ttl)), ec);
+    }
+
+    if (!ec)
+    {
+        socket_.set_option(boost::asio::ip::multicast::enable_loopback(option.loopback), ec);
+    }
+
+    if ((!ec) && (!option.interfaceAddress.isEmpty()))
+    {
+        auto interfaceAddress = boost::asio::ip::make_address_v4(option.interfaceAddress.toStdString(), ec);
+        if (!ec)
+        {
+            socket_.set_option(boost::asio::ip::multicast::outbound_interface(interfaceAddress), ec);
+        }
+    }
+
+    if (!ec)
+    {
+        //发送缓冲区满时丢弃,由客户端根据序号请求重新同步
+        socket_.non_blocking(true, ec);
+    }
+
+    if (ec)
+    {
+        LOGERROR(QStringLiteral("[%1:%2] open multicast socket error,value = %3, message=%4")
+                 .arg(__FUNCTION__)
+                 .arg(__LINE__)
+                 .arg(ec.value())
+                 .arg(CommonFunction::GBKtoUTF8(ec.message()).c_str()));
+
+        socket_.close(ec);
+        return false;
+    }
+
+    LOGINFO(QStringLiteral("[%1:%2] multicast publish to %3:%4")
+            .arg(__FUNCTION__)
+            .arg(__LINE__)
+            .arg(option.address)
+            .arg(option.port));
+
+    isRun_ = true;
+    return true;
+}
+
+void MulticastPublisher::stop()
+{
+    isRun_ = false;
+
+    {
+        lock_guard<shared_mutex> lg(lockSocket_);
+        boost::system::error_code ec;
+        socket_.close(ec);
+    }
+
+    lock_guard<mutex> lg(lockSequence_);
+    sequence_.clear();
+}
+
+void MulticastPublisher::publish(User userid, const QString& cid, const QJsonValue& value)
+{
+    if (!isRun_)
+    {
+        return;
+    }
+
+    //seq 以外的字段在锁外序列化,分配序号后只拼接前缀
+    QJsonObject jo;
+    jo.insert("userid", static_cast<qint64>(userid.userID));
+    jo.insert("cid", cid);
+    jo.insert("value", value);
+    const QByteArray body = QJsonDocument(jo).toJson(QJsonDocument::Compact);
+
+    //{"seq":%d, 最长 28 字节
+    const bool tooLarge = (static_cast<size_t>(body.size()) + 28 > MaxDatagramLength);
+
+    //超长或发送失败的数据报同样占用序号,客户端会看到序号缺失
+    //同一用户的序号分配和发送在该用户的锁内完成,不同用户之间互不等待;非阻塞的 send_to 只是一次系统调用
+    boost::system::error_code ec;
+    {
+        auto userSequence = getUserSequence_(userid);
+        lock_guard<mutex> lgSequence(userSequence->lock);
+        uint64_t seq = ++userSequence->seq;
+        if (!tooLarge)
+        {
+            QByteArray datagram("{\"seq\":");
+            datagram.append(QByteArray::number(static_cast<qulonglong>(seq))).append(',').append(body.mid(1));
+
+            shared_lock<shared_mutex> lg(lockSocket_);
+            socket_.send_to(boost::asio::buffer(datagram.constData(), datagram.size()), endpoint_, 0, ec);
+        }
+    }
+
+    if (tooLarge)
+    {
+        LOGWARN(QStringLiteral("[%1:%2] component %3 value is too large for multicast, length = %4")
+                .arg(__FUNCTION__)
+                .arg(__LINE__)
+                .arg(cid)
+                .arg(body.size()));
+        return;
+    }
+
+    if (ec && (ec != boost::asio::error::would_block))
+    {
+        LOGWARN(QStringLiteral("[%1:%2] multicast send error,value = %3, message=%4")
+                .arg(__FUNCTION__)
+                .arg(__LINE__)
+                .arg(ec.value())
+                .arg(CommonFunction::GBKtoUTF8(ec.message()).c_str()));
+    }
+}
+
+uint64_t MulticastPublisher::snapshot(User userid, const std::function<void()>& snapshot)
+{
+    auto userSequence = getUserSequence_(userid);
+    lock_guard<mutex> lg(userSequence->lock);
+    snapshot();
+    return userSequence->seq;
+}
+
+std::shared_ptr<MulticastPublisher::UserSequence> MulticastPublisher::getUserSequence_(User userid)
+{
+    lock_guard<mutex> lg(lockSequence_);
+    auto& userSequence = sequence_[userid];
+    if (!userSequence)
+    {
+        userSequence = make_shared<UserSequence>();
+    }
+
+    return userSequence;
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+/*******************************************************************************
+EasyVsp System
+Copyright (c) 2022 Jimmy Song
+
+MIT License
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+******************************************************************************/
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <QHash>
+#include <QString>
+#include <QJsonValue>
+#include "commonstruct.h"
+
+struct MulticastOption
+{
+    bool enable{false};
+    QString address{"239.255.0.1"};            //组播地址
+    uint16_t port{12359};
+    size_t ttl{1};                              //1 表示只在本网段内
+    QString interfaceAddress;                   //发送使用的本机网卡地址,为空时由系统选择
+    bool loopback{true};                        //本机是否接收自己发出的组播
+};
+
+//输出组件值变化的 UDP 组播发布,每次变化只发送一次
+//数据报: {"seq":%d,"userid":%d,"cid":%s,"value":%s},seq 按用户递增,同一用户的数据报按序号顺序发出
+//客户端发现序号不连续时通过 tcp 发送 resync
+class MulticastPublisher
+{
+    Q_DISABLE_COPY(MulticastPublisher)
+public:
+    MulticastPublisher();
+    ~MulticastPublisher();
+
+    bool start(const MulticastOption& option);
+    void stop();
+
+    void publish(Jimmy::User userid, const QString& cid, const QJsonValue& value);
+
+    //在该用户的发布锁内执行 snapshot 并返回此时的序号,执行期间该用户不会发出新的数据报
+    uint64_t snapshot(Jimmy::User userid, const std::function<void()>& snapshot);
+private:
+    struct UserSequence
+    {
+        std::mutex lock;                                //分配序号和发送在同一把锁内
+        uint64_t seq{0};
+    };
+
+    std::shared_ptr<UserSequence> getUserSequence_(Jimmy::User userid);
+private:
+    static const size_t MaxDatagramLength = 65000;
+
+    boost::asio::io_context ioContext_;
+    boost::asio::ip::udp::socket socket_;
+    boost::asio::ip::udp::endpoint endpoint_;
+
+    std::shared_mutex lockSocket_;                      //发送时共享,关闭套接字时独占
+    std::mutex lockSequence_;                           //只保护用户表,组包在锁外进行
+    QHash<Jimmy::User, std::shared_ptr<UserSequence>> sequence_;
+    std::atomic_bool isRun_;
+};
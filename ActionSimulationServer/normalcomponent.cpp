@@ -291,11 +291,17 @@ void NormalComponent::onAction(User userid,const QString& trigger,const QJsonVal
 
         if(value.toBool())
         {
-            lock_guard<shared_mutex> lg(lockValue_);
-            auto userVal = getUserValue_(userid,true);
-            userVal->value = !userVal->value.toBool();
-            gActionSimulationServer.getUserManager()->sendUserMessage(userid,sendAdminOnly(),getAnswerValue(value));
-            gActionSimulationServer.getProjectManager()->notifyComponentChange(userid,getID(),userVal->value);
+            QJsonValue newValue;
+            {
+                lock_guard<shared_mutex> lg(lockValue_);
+                auto userVal = getUserValue_(userid,true);
+                userVal->value = !userVal->value.toBool();
+                newValue = userVal->value;
+                gActionSimulationServer.getUserManager()->sendUserMessage(userid,sendAdminOnly(),getAnswerValue(value),getID());
+            }
+
+            //组播发布持有用户的序号锁,resync 在该锁内读取组件值,通知不能在组件锁内进行
+            gActionSimulationServer.getProjectManager()->notifyComponentChange(userid,getID(),newValue);
         }
 
         return;
@@ -321,6 +327,32 @@ void NormalComponent::onAction(User userid,const QString& trigger,const QJsonVal
     }
 }
 
+void NormalComponent::onBatchAction(User userid,const QJsonObject& triggers,const QString& trigger,const QJsonValue& value)
+{
+    //跟随输入和取反的组件只看最后一个触发来源
+    if(getBehavior() != BehaviorType::Script)
+    {
+        onAction(userid,trigger,value);
+        return;
+    }
+
+    if(!actionScript_)
+    {
+        LOGERROR(QStringLiteral("[%1:%2] component:{%3} is not start")
+            .arg(__FUNCTION__)
+            .arg(__LINE__)
+            .arg(getID()));
+
+        return;
+    }
+    auto results = actionScript_->onAction(collectInputs(userid,triggers));
+    if(!results)
+    {
+        return;
+    }
+    analysisResult(userid,results.value());
+}
+
 void NormalComponent::onTime(User userid,size_t counter)
 {
     if(!actionScript_)
@@ -448,6 +480,20 @@ QJsonObject NormalComponent::collectInputs(User userid,const QString& trigger,co
     return jo;
 }
 
+//batch 合并的事件:_trigger 为 _batch,_triggers 为所有触发来源及其值,来源的值同样按 cid 放入参数
+QJsonObject NormalComponent::collectInputs(User userid,const QJsonObject& triggers)
+{
+    QJsonObject jo = collectInputs(userid,CommonConst::Boardcast,QJsonValue());
+    jo.insert("_trigger", CommonConst::BatchEvent);
+    jo.insert("_triggers", triggers);
+    for (auto itor = triggers.begin(); itor != triggers.end(); ++itor)
+    {
+        jo.insert(itor.key(), itor.value());
+    }
+
+    return jo;
+}
+
 void NormalComponent::getRelationParams(User userid,const QString& trigger,QJsonObject& jo)
 {
     auto items = getSubscription() + getReference();
@@ -527,7 +573,7 @@ void NormalComponent::setValue_(User userid,const QJsonValue& value,bool enableS
         }
     }
 
-    gActionSimulationServer.getUserManager()->sendUserMessage(userid,sendAdminOnly(),getAnswerValue(value));
+    gActionSimulationServer.getUserManager()->sendUserMessage(userid,sendAdminOnly(),getAnswerValue(value),getID());
     gActionSimulationServer.getProjectManager()->notifyComponentChange(userid,getID(),value);
     return;
 }
@@ -580,7 +626,7 @@ void NormalComponent::analysisResult(User userid, const QJsonObject& result)
 
     if (valueChange)
     {
-        gActionSimulationServer.getUserManager()->sendUserMessage(userid,sendAdminOnly(),getAnswerValue(valueItor.value()));
+        gActionSimulationServer.getUserManager()->sendUserMessage(userid,sendAdminOnly(),getAnswerValue(valueItor.value()),getID());
         gActionSimulationServer.getProjectManager()->notifyComponentChange(userid, getID(),valueItor.value());
     }
 
@@ -63,6 +63,7 @@ public:
     void onBoardcast(User userid) override;
     
     void onAction(User userid,const QString& trigger,const QJsonValue& value) override;
+    void onBatchAction(User userid,const QJsonObject& triggers,const QString& trigger,const QJsonValue& value) override;
     void onTime(User userid,size_t counter) override;
     void onLoop(User userid,const QJsonValue& value) override;
 
@@ -89,6 +90,7 @@ private:
     QJsonObject collectInputs();
     QJsonObject collectInputs(User userid,size_t counter);
     QJsonObject collectInputs(User userid,const QString& trigger,const QJsonValue& value);
+    QJsonObject collectInputs(User userid,const QJsonObject& triggers);
 
     void getRelationParams(User userid,const QString& trigger,QJsonObject& jo);
 
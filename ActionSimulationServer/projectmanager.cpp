@@ -30,10 +30,12 @@ SOFTWARE.
 #include "usermanager.h"
 #include "logger.h"
 #include <QJsonDocument>
+#include "messagecodec.h"
 #include "inputcomponent.h"
 #include "normalcomponent.h"
 #include "teammastercomponent.h"
 #include "teamslavecomponent.h"
+#include "flatjsonparser.h"
 
 using namespace std;
 using namespace Jimmy;
@@ -43,11 +45,27 @@ const char* const ProjectManager::Succeed = "succeed";
 const char* const ProjectManager::Failed = "failed";
 const char* const ProjectManager::Result = "result";
 const char* const ProjectManager::Reason = "reason";
+const char* const ProjectManager::SessionID = "sid";
 
 ProjectManager::ProjectManager()
+    :isRun_(true)
 {
     initializesDispatcher();
-    commandTCPDataThread_ = std::thread(std::bind(&ProjectManager::commandTcpDataThread, this));
+
+    size_t threadCount = gActionSimulationServer.getAppConfig()->getCommandThreadCount();
+    if (threadCount == 0)
+    {
+        threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        auto shard = make_unique<CommandShard>();
+        shard->thread = std::thread(std::bind(&ProjectManager::commandTcpDataThread, this, shard.get()));
+        commandShards_.push_back(std::move(shard));
+    }
+
+    commandControlThread_ = std::thread(std::bind(&ProjectManager::commandControlThread, this));
 
     projectStatus_ = ProjectStatus::invalid;
     loadProject_();
@@ -57,6 +75,33 @@ ProjectManager::~ProjectManager()
 {
     isRun_ = false;
 
+    //等待中的线程要么已看到 isRun_,要么已在等待,加锁后再通知不会丢失唤醒
+    for (auto& shard : commandShards_)
+    {
+        {
+            lock_guard<mutex> lg(shard->lockMsgData);
+        }
+        shard->cvMsgData.notify_all();
+    }
+
+    {
+        lock_guard<mutex> lg(lockControlData_);
+    }
+    cvControlData_.notify_all();
+
+    for (auto& shard : commandShards_)
+    {
+        if (shard->thread.joinable())
+        {
+            shard->thread.join();
+        }
+    }
+
+    if (commandControlThread_.joinable())
+    {
+        commandControlThread_.join();
+    }
+
     if(getStatus() == ProjectStatus::running)
     {
         stopProject_();
@@ -194,6 +239,7 @@ bool ProjectManager::loadGeneral(const QJsonObject& jo)
 bool ProjectManager::loadComponent()
 {
     components_.clear();
+    componentHandles_.clear();
     subscriptionComponents_.clear();
 
     for(auto itor = json_components_.constBegin();itor!=json_components_.constEnd();++itor)
@@ -236,6 +282,8 @@ bool ProjectManager::loadComponent()
            return false;
        }
 
+       component->setHandle(componentHandles_.size());
+       componentHandles_.push_back(component);
        components_.insert(component->getID(), component);
     }
 
@@ -263,28 +311,68 @@ void ProjectManager::initializesDispatcher()
     commandDispatcher_.insert("query_all_value", std::bind(&ProjectManager::queryAllValue, this, placeholders::_1, placeholders::_2));
     commandDispatcher_.insert("query_value", std::bind(&ProjectManager::queryValue, this, placeholders::_1, placeholders::_2));
     commandDispatcher_.insert("component_status_change", std::bind(&ProjectManager::componentStatusChange, this, placeholders::_1, placeholders::_2));
+    commandDispatcher_.insert("batch", std::bind(&ProjectManager::batchComponentStatusChange, this, placeholders::_1, placeholders::_2));
+
+    commandDispatcher_.insert("resync", std::bind(&ProjectManager::resync, this, placeholders::_1, placeholders::_2));
+    commandDispatcher_.insert("get_connection_status", std::bind(&ProjectManager::getConnectionStatus, this, placeholders::_1, placeholders::_2));
+    commandDispatcher_.insert("close_session", std::bind(&ProjectManager::closeSession, this, placeholders::_1, placeholders::_2));
+
+    exclusiveActions_ << "load" << "run" << "stop" << "reload_script";
 }
 
 void ProjectManager::pushMessage(size_t connectionId, const std::string& message)
 {
+    //在 io 线程上按用户限流,超出速率的消息不进入命令队列
+    if (!gActionSimulationServer.getUserManager()->acquireIngress(connectionId))
+    {
+        return;
+    }
+
+    appendMessage_(Connection{connectionId}, message);
+}
+
+void ProjectManager::appendMessage_(const Jimmy::Connection& connection, const std::string& message)
+{
+    auto& shard = *commandShards_[connection.ConnectionID % commandShards_.size()];
     {
-        lock_guard<mutex> lg(lockMsgData_);
-        msgData_.push_back(QPair(Connection{connectionId},QString::fromLocal8Bit(message.c_str())));
+        lock_guard<mutex> lg(shard.lockMsgData);
+        shard.msgData.push_back(QPair(connection, message));
     }
 
-    cvMsgData_.notify_one();
+    shard.cvMsgData.notify_one();
 }
 
-void ProjectManager::commandTcpDataThread()
+void ProjectManager::pushControlMessage(size_t connectionId, const std::string& message)
+{
+    {
+        lock_guard<mutex> lg(lockControlData_);
+        controlData_.push_back(QPair(Connection{connectionId},message));
+    }
+
+    cvControlData_.notify_one();
+}
+
+void ProjectManager::resyncConnection(size_t connectionId)
+{
+    appendMessage_(Connection{connectionId}, "{\"action\":\"resync\"}");
+
+    //网关连接丢弃的消息可能属于任一会话,所有会话都需要重新同步
+    foreach (auto sessionID, gActionSimulationServer.getUserManager()->getSessions(connectionId))
+    {
+        appendMessage_(Connection{connectionId}, QStringLiteral("{\"action\":\"resync\",\"sid\":%1}").arg(sessionID).toStdString());
+    }
+}
+
+void ProjectManager::commandTcpDataThread(CommandShard* shard)
 {
     while (isRun_)
     {
-        QQueue<QPair<Connection,QString>> TcpData;
+        QQueue<QPair<Connection,std::string>> TcpData;
         {
-            unique_lock<mutex> lg(lockMsgData_);
-            cvMsgData_.wait(lg, [this] {return (!isRun_) || (!msgData_.empty()); });
+            unique_lock<mutex> lg(shard->lockMsgData);
+            shard->cvMsgData.wait(lg, [this, shard] {return (!isRun_) || (!shard->msgData.empty()); });
             if (!isRun_) { break; }
-            TcpData.swap(msgData_);
+            TcpData.swap(shard->msgData);
         }
 
         while (!TcpData.empty())
@@ -295,24 +383,163 @@ void ProjectManager::commandTcpDataThread()
     }
 }
 
-void ProjectManager::disposeCommand(Jimmy::Connection connection, const QString& message)
+void ProjectManager::commandControlThread()
 {
-    QJsonParseError error;
-    QJsonDocument jd = QJsonDocument::fromJson(message.toLocal8Bit(),&error);
+    while (isRun_)
+    {
+        QQueue<QPair<Connection,std::string>> controlData;
+        {
+            unique_lock<mutex> lg(lockControlData_);
+            cvControlData_.wait(lg, [this] {return (!isRun_) || (!controlData_.empty()); });
+            if (!isRun_) { break; }
+            controlData.swap(controlData_);
+        }
 
-    if(error.error!=QJsonParseError::NoError)
+        while (!controlData.empty())
+        {
+            auto pData = controlData.dequeue();
+            //管理端口连接的所有命令都在控制线程上按接收顺序执行
+            disposeCommand(pData.first, pData.second);
+        }
+    }
+}
+
+//只含 cid / value (及 action、sid) 的组件状态变化直接在 UTF-8 数据上取出字段
+//无法处理时返回 false,由 disposeCommand 按 QJsonDocument 解析并输出错误信息
+bool ProjectManager::disposeComponentStatusChange_(Jimmy::Connection connection, const std::string& message)
+{
+    FlatJsonParser parser;
+    if (!parser.parse(message.data(), message.size()))
     {
-        LOGERROR(QStringLiteral("[%1:%2] 解析 %3 失败")
-            .arg(__FUNCTION__)
-            .arg(__LINE__)
-            .arg(message));
+        return false;
+    }
+
+    auto action = parser.find(Action);
+    if (action && ((action->type != QJsonValue::String) || (action->raw != "component_status_change")))
+    {
+        return false;
+    }
+
+    //{"h":%d,"v":%r} 以 load 返回的句柄代替 cid,按下标取组件
+    shared_ptr<CoreComponent> component;
+    auto cid = parser.find("cid");
+    auto value = parser.find("value");
+    if (!cid)
+    {
+        auto handle = parser.find("h");
+        value = parser.find("v");
+        if ((!handle) || (handle->type != QJsonValue::Double) || (!value))
+        {
+            return false;
+        }
+
+        component = getComponent(FlatJsonParser::toValue(*handle).toInt(-1));
+        if (!component)
+        {
+            LOGERROR(QStringLiteral("[%1:%2] handle %3 is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__)
+                .arg(FlatJsonParser::toString(*handle)));
+
+            return true;
+        }
+    }
+    else if ((cid->type != QJsonValue::String) || (!value))
+    {
+        return false;
+    }
 
+    auto sid = parser.find(SessionID);
+    if (sid && gActionSimulationServer.getUserManager()->isGateway(connection.ConnectionID))
+    {
+        auto sessionID = FlatJsonParser::toValue(*sid);
+        if ((!sessionID.isDouble()) || (sessionID.toDouble() < 1))
+        {
+            return false;
+        }
+
+        connection.SessionID = static_cast<size_t>(sessionID.toDouble());
+        gActionSimulationServer.getUserManager()->registerSession(connection);
+    }
+
+    shared_lock<WriterPreferringMutex> lg(lockCommand_);
+    if (projectStatus_ == ProjectStatus::running)
+    {
+        if (component)
+        {
+            component->setValue(connection, FlatJsonParser::toValue(*value));
+        }
+        else
+        {
+            setComponentValue_(connection, FlatJsonParser::toString(*cid), FlatJsonParser::toValue(*value));
+        }
+    }
+
+    return true;
+}
+
+void ProjectManager::disposeCommand(Jimmy::Connection connection, const std::string& message)
+{
+    if (disposeComponentStatusChange_(connection, message))
+    {
         return;
     }
 
+    QJsonObject msg;
+    auto rawMessage = QByteArray::fromRawData(message.data(), static_cast<int>(message.size()));
+
+    if (MessageCodec::isCbor(message.data(), message.size()))
+    {
+        QString error;
+        if (!MessageCodec::fromCbor(rawMessage, msg, error))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] 解析 cbor 消息失败: %3")
+                .arg(__FUNCTION__)
+                .arg(__LINE__)
+                .arg(error));
+
+            return;
+        }
+    }
+    else
+    {
+        QJsonParseError error;
+        QJsonDocument jd = QJsonDocument::fromJson(rawMessage,&error);
+
+        if(error.error!=QJsonParseError::NoError)
+        {
+            LOGERROR(QStringLiteral("[%1:%2] 解析 %3 失败")
+                .arg(__FUNCTION__)
+                .arg(__LINE__)
+                .arg(QString::fromUtf8(message.c_str())));
+
+            return;
+        }
+
+        msg = jd.object();
+    }
+
     QString action;
 
-    QJsonObject msg = jd.object();
+    //网关连接上的消息以 sid 区分会话,其余连接忽略 sid
+    auto sidItor = msg.find(SessionID);
+    if((sidItor != msg.end()) && gActionSimulationServer.getUserManager()->isGateway(connection.ConnectionID))
+    {
+        if((!sidItor->isDouble()) || (sidItor->toDouble() < 1))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] %3  sid is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__)
+                .arg(QString::fromUtf8(MessageCodec::toJson(msg))));
+
+            return;
+        }
+
+        connection.SessionID = static_cast<size_t>(sidItor->toDouble());
+        msg.erase(sidItor);
+        gActionSimulationServer.getUserManager()->registerSession(connection);
+    }
+
     auto elemItor = msg.find(Action);
     if(elemItor == msg.end())
     {
@@ -325,7 +552,7 @@ void ProjectManager::disposeCommand(Jimmy::Connection connection, const QString&
             LOGERROR(QStringLiteral("[%1:%2] %3  action is invalid")
                 .arg(__FUNCTION__)
                 .arg(__LINE__)
-                .arg(message));
+                .arg(QString::fromUtf8(MessageCodec::toJson(msg))));
 
             return;
         }
@@ -338,15 +565,24 @@ void ProjectManager::disposeCommand(Jimmy::Connection connection, const QString&
         msg.insert(Result, Failed);
         msg.insert(Reason, "unsupported action");
 
-        gActionSimulationServer.getUserManager()->answerMessage(connection, QJsonDocument(msg).toJson(QJsonDocument::Compact));
+        gActionSimulationServer.getUserManager()->answerMessage(connection, msg);
         return;
     }
 
+    if (exclusiveActions_.contains(action))
+    {
+        lock_guard<WriterPreferringMutex> lg(lockCommand_);
+        itor.value()(connection, msg);
+        return;
+    }
+
+    shared_lock<WriterPreferringMutex> lg(lockCommand_);
     itor.value()(connection, msg);
 }
 
 void ProjectManager::run()
 {
+    lock_guard<WriterPreferringMutex> lg(lockCommand_);
     if (projectStatus_ == ProjectStatus::stopped)
     {
         projectStatus_ = ProjectStatus::prepare;
@@ -356,6 +592,7 @@ void ProjectManager::run()
 
 void ProjectManager::stop()
 {
+    lock_guard<WriterPreferringMutex> lg(lockCommand_);
     if (projectStatus_ == ProjectStatus::running)
     {
         projectStatus_ = ProjectStatus::prepare;
@@ -376,6 +613,13 @@ void ProjectManager::removeScheduledTask(const Jimmy::ScheduledTask& tt)
 
 void ProjectManager::notifyComponentChange(Jimmy::User userid,const QString& cid,const QJsonValue& value)
 {
+    //输出组件的变化同时发往组播,只读显示端不必逐个建立 tcp 连接
+    auto component = components_.find(cid);
+    if ((component != components_.end()) && (component.value()->getType() == ComponentType::Output))
+    {
+        gActionSimulationServer.multicastComponentChange(userid, cid, value);
+    }
+
     auto itor = subscriptionComponents_.find(cid);
     if (itor == subscriptionComponents_.end())
     {
@@ -392,6 +636,12 @@ void ProjectManager::notifyComponentChange(Jimmy::User userid,const QString& cid
             componentChangeEvent.trigger = cid;
             componentChangeEvent.value = value;
 
+            //batch 命令及其引起的各级变化按订阅组件合并
+            if (ThreadPool::mergeIntoWave(componentChangeEvent))
+            {
+                continue;
+            }
+
             threadPool.notifyComponentChange(componentChangeEvent);
         }
     }
@@ -413,6 +663,16 @@ std::shared_ptr<Jimmy::CoreComponent> ProjectManager::getComponent(const QString
     return itor.value();
 }
 
+std::shared_ptr<Jimmy::CoreComponent> ProjectManager::getComponent(int handle)
+{
+    if ((handle < 0) || (handle >= componentHandles_.size()))
+    {
+        return nullptr;
+    }
+
+    return componentHandles_.at(handle);
+}
+
 Jimmy::ErrorCode ProjectManager::runProject_()
 {
     generateSubscriptionComponents();
@@ -505,7 +765,7 @@ void ProjectManager::setLog(Jimmy::Connection connection, QJsonObject& jo)
         }
     }
 
-    gActionSimulationServer.getUserManager()->answerMessage(connection,QJsonDocument(jo).toJson(QJsonDocument::Compact));
+    gActionSimulationServer.getUserManager()->answerMessage(connection,jo);
 }
 
 void ProjectManager::setBoardcastCode(Jimmy::Connection connection, QJsonObject& jo)
@@ -520,7 +780,7 @@ void ProjectManager::setBoardcastCode(Jimmy::Connection connection, QJsonObject&
     {
         jo.insert(Result, Failed);
         jo.insert(Reason, "value is invalid");
-        gActionSimulationServer.getUserManager()->answerMessage(connection,QJsonDocument(jo).toJson(QJsonDocument::Compact));
+        gActionSimulationServer.getUserManager()->answerMessage(connection,jo);
         return;
     }
 
@@ -544,7 +804,7 @@ void ProjectManager::setBoardcastCode(Jimmy::Connection connection, QJsonObject&
     }
 
     jo.insert(Result, Succeed);
-    gActionSimulationServer.getUserManager()->answerMessage(connection,QJsonDocument(jo).toJson(QJsonDocument::Compact));
+    gActionSimulationServer.getUserManager()->answerMessage(connection,jo);
 }
 
 void ProjectManager::cancelBoardcastCode(Jimmy::Connection connection, QJsonObject& jo)
@@ -559,7 +819,7 @@ void ProjectManager::cancelBoardcastCode(Jimmy::Connection connection, QJsonObje
     {
         jo.insert(Result, Failed);
         jo.insert(Reason, "value is invalid");
-        gActionSimulationServer.getUserManager()->answerMessage(connection,QJsonDocument(jo).toJson(QJsonDocument::Compact));
+        gActionSimulationServer.getUserManager()->answerMessage(connection,jo);
         return;
     }
 
@@ -583,7 +843,7 @@ void ProjectManager::cancelBoardcastCode(Jimmy::Connection connection, QJsonObje
     }
 
     jo.insert(Result, Succeed);
-    gActionSimulationServer.getUserManager()->answerMessage(connection,QJsonDocument(jo).toJson(QJsonDocument::Compact));
+    gActionSimulationServer.getUserManager()->answerMessage(connection,jo);
 }
 
 void ProjectManager::getBoardcastCode(Jimmy::Connection connection, QJsonObject& jo)
@@ -601,7 +861,7 @@ void ProjectManager::getBoardcastCode(Jimmy::Connection connection, QJsonObject&
 
     jo.insert("value",QJsonArray::fromStringList(boardcast_.getBoardcast(userInfo->userId)));
 
-    gActionSimulationServer.getUserManager()->answerMessage(connection,QJsonDocument(jo).toJson(QJsonDocument::Compact));
+    gActionSimulationServer.getUserManager()->answerMessage(connection,jo);
 }
 
 void ProjectManager::actionFailed(Jimmy::Connection connection,const QString& action,const QString& reason)
@@ -610,12 +870,11 @@ void ProjectManager::actionFailed(Jimmy::Connection connection,const QString& ac
     joRet.insert("action", action);
     joRet.insert(Result, Failed);
     joRet.insert(Reason, reason);
-    gActionSimulationServer.getUserManager()->answerMessage(connection, QJsonDocument(joRet).toJson(QJsonDocument::Compact));
+    gActionSimulationServer.getUserManager()->answerMessage(connection, joRet);
 }
 
 void ProjectManager::loadProject(Jimmy::Connection connection, QJsonObject& jo)
 {
-    Q_UNUSED(jo)
     if (projectStatus_== ProjectStatus::invalid)
     {
         actionFailed(connection,"load_project","current project is invalid");
@@ -637,7 +896,20 @@ void ProjectManager::loadProject(Jimmy::Connection connection, QJsonObject& jo)
     jRe.insert("components",json_components_);
     jRe.insert("category",json_category_);
 
-    gActionSimulationServer.getUserManager()->answerMessage(connection,QJsonDocument(jRe).toJson(QJsonDocument::Compact));
+    //请求句柄的连接之后收到的组件变化以句柄代替 cid
+    if (jo.value("handle").toBool())
+    {
+        QJsonObject handles;
+        foreach (const auto& component, componentHandles_)
+        {
+            handles.insert(component->getID(), component->getHandle());
+        }
+
+        jRe.insert("handles",handles);
+        gActionSimulationServer.getUserManager()->setComponentHandle(connection);
+    }
+
+    gActionSimulationServer.getUserManager()->answerMessage(connection,jRe);
 }
 
 void ProjectManager::runProject(Jimmy::Connection connection, QJsonObject& jo)
@@ -652,7 +924,7 @@ void ProjectManager::runProject(Jimmy::Connection connection, QJsonObject& jo)
     {
         jo.insert(Result, Failed);
         jo.insert(Reason, "insufficient privileges");
-        gActionSimulationServer.getUserManager()->answerMessage(connection,QJsonDocument(jo).toJson(QJsonDocument::Compact));
+        gActionSimulationServer.getUserManager()->answerMessage(connection,jo);
         return;
     }
 
@@ -681,7 +953,7 @@ void ProjectManager::runProject(Jimmy::Connection connection, QJsonObject& jo)
     }
     }
 
-    gActionSimulationServer.getUserManager()->answerMessage(connection,QJsonDocument(jo).toJson(QJsonDocument::Compact));
+    gActionSimulationServer.getUserManager()->answerMessage(connection,jo);
 }
 
 void ProjectManager::stopProject(Jimmy::Connection connection, QJsonObject& jo)
@@ -696,7 +968,7 @@ void ProjectManager::stopProject(Jimmy::Connection connection, QJsonObject& jo)
     {
         jo.insert(Result, Failed);
         jo.insert(Reason, "insufficient privileges");
-        gActionSimulationServer.getUserManager()->answerMessage(connection,QJsonDocument(jo).toJson());
+        gActionSimulationServer.getUserManager()->answerMessage(connection,jo);
         return;
     }
 
@@ -720,7 +992,7 @@ void ProjectManager::stopProject(Jimmy::Connection connection, QJsonObject& jo)
     }
     }
 
-    gActionSimulationServer.getUserManager()->answerMessage(connection,QJsonDocument(jo).toJson(QJsonDocument::Compact));
+    gActionSimulationServer.getUserManager()->answerMessage(connection,jo);
 }
 
 void ProjectManager::resetProject(Jimmy::Connection connection, QJsonObject& jo)
@@ -746,7 +1018,7 @@ void ProjectManager::getProjectStatus(Jimmy::Connection connection, QJsonObject&
     joRet.insert("action", "get_project_status");
     joRet.insert("name", gActionSimulationServer.getAppConfig()->getProjectFile().baseName());
     joRet.insert("value", ::getProjectStatus(getStatus()));
-    gActionSimulationServer.getUserManager()->answerMessage(connection, QJsonDocument(joRet).toJson(QJsonDocument::Compact));
+    gActionSimulationServer.getUserManager()->answerMessage(connection, joRet);
 }
 
 void ProjectManager::setLogin(Jimmy::Connection connection, QJsonObject& jo)
@@ -760,7 +1032,7 @@ void ProjectManager::setLogin(Jimmy::Connection connection, QJsonObject& jo)
         {
             jo.insert(Result, Failed);
             jo.insert(Reason, "userid is not exist");
-            gActionSimulationServer.getUserManager()->answerMessage(connection, QJsonDocument(jo).toJson(QJsonDocument::Compact));
+            gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
             return;
         }
 
@@ -769,7 +1041,7 @@ void ProjectManager::setLogin(Jimmy::Connection connection, QJsonObject& jo)
         {
             jo.insert(Result, Failed);
             jo.insert(Reason, "userid is invalid");
-            gActionSimulationServer.getUserManager()->answerMessage(connection, QJsonDocument(jo).toJson(QJsonDocument::Compact));
+            gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
             return;
         }
     }
@@ -781,10 +1053,48 @@ void ProjectManager::setLogin(Jimmy::Connection connection, QJsonObject& jo)
         role = roleItor->toInt();
     }
 
+    //编码属于整条连接,网关上的会话沿用网关的编码
+    QString codec;
+    auto codecItor = jo.find("codec");
+    if(codecItor != jo.end())
+    {
+        codec = codecItor->toString();
+        if((connection.SessionID != 0) || (!gActionSimulationServer.supportCodec(connection.ConnectionID, codec)))
+        {
+            jo.insert(Result, Failed);
+            jo.insert(Reason, "codec is not supported");
+            gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
+            return;
+        }
+    }
+
+    //网关可以代理任意用户的会话,只允许配置的地址
+    auto gatewayItor = jo.find("gateway");
+    bool gateway = (connection.SessionID == 0) && (gatewayItor != jo.end()) && gatewayItor->toBool();
+    if(gateway && (!gActionSimulationServer.isGatewayAllowed(connection.ConnectionID)))
+    {
+        jo.insert(Result, Failed);
+        jo.insert(Reason, "gateway is not allowed");
+        gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
+        return;
+    }
+
     gActionSimulationServer.getUserManager()->login(connection,user,role);
+    gActionSimulationServer.setConnectionLogin(connection.ConnectionID);
+
+    if(gateway)
+    {
+        gActionSimulationServer.getUserManager()->setGateway(connection.ConnectionID);
+    }
 
     jo.insert(Result, Succeed);
-    gActionSimulationServer.getUserManager()->answerMessage(connection, QJsonDocument(jo).toJson(QJsonDocument::Compact));
+    gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
+
+    //登录应答仍按原编码发送,之后的消息才切换编码
+    if(!codec.isEmpty())
+    {
+        gActionSimulationServer.setConnectionCodec(connection.ConnectionID, codec);
+    }
 }
 
 void ProjectManager::queryAllValue(Jimmy::Connection connection, QJsonObject& jo)
@@ -798,26 +1108,36 @@ void ProjectManager::queryAllValue(Jimmy::Connection connection, QJsonObject& jo
 
     foreach (auto& component ,components_.values())
     {
-        gActionSimulationServer.getUserManager()->answerMessage(connection,component->getAnswerValue(component->getValue(userInfo->userId)));
+        gActionSimulationServer.getUserManager()->answerMessage(*userInfo,component->getAnswerValue(component->getValue(userInfo->userId)));
     }
 }
 
 void ProjectManager::queryValue(Jimmy::Connection connection, QJsonObject& jo)
 {
-    auto cidItor = jo.find("cid");
-    if ((cidItor == jo.end())||(!cidItor->isString()))
+    shared_ptr<CoreComponent> component;
+    auto handleItor = jo.find("h");
+    if (handleItor != jo.end())
     {
-        LOGERROR(QStringLiteral("[%1:%2] cid is invalid")
-            .arg(__FUNCTION__)
-            .arg(__LINE__));
+        component = getComponent(handleItor->toInt(-1));
+    }
+    else
+    {
+        auto cidItor = jo.find("cid");
+        if ((cidItor == jo.end())||(!cidItor->isString()))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] cid is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
 
-        return;
+            return;
+        }
+
+        component = getComponent(cidItor->toString());
     }
 
-    shared_ptr<CoreComponent> component = getComponent(cidItor->toString());
     if (!component)
     {
-        LOGERROR(QStringLiteral("[%1:%2] cid is not exist")
+        LOGERROR(QStringLiteral("[%1:%2] component is not exist")
             .arg(__FUNCTION__)
             .arg(__LINE__));
 
@@ -830,7 +1150,7 @@ void ProjectManager::queryValue(Jimmy::Connection connection, QJsonObject& jo)
         return;
     }
 
-    gActionSimulationServer.getUserManager()->answerMessage(connection,component->getAnswerValue(component->getValue(userInfo->userId)));
+    gActionSimulationServer.getUserManager()->answerMessage(*userInfo,component->getAnswerValue(component->getValue(userInfo->userId)));
 }
 
 void ProjectManager::componentStatusChange(Jimmy::Connection connection, QJsonObject& jo)
@@ -840,6 +1160,24 @@ void ProjectManager::componentStatusChange(Jimmy::Connection connection, QJsonOb
         return;
     }
 
+    auto handleItor = jo.find("h");
+    if (handleItor != jo.end())
+    {
+        auto component = getComponent(handleItor->toInt(-1));
+        auto valueItor = jo.find("v");
+        if ((!component) || (valueItor == jo.end()))
+        {
+            LOGERROR(QStringLiteral("[%1:%2] handle or value is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__));
+
+            return;
+        }
+
+        component->setValue(connection, valueItor.value());
+        return;
+    }
+
     auto cidItor = jo.find("cid");
     if ((cidItor == jo.end())||(!cidItor->isString()))
     {
@@ -860,18 +1198,81 @@ void ProjectManager::componentStatusChange(Jimmy::Connection connection, QJsonOb
         return;
     }
 
-    shared_ptr<CoreComponent> component = getComponent(cidItor->toString());
+    setComponentValue_(connection, cidItor->toString(), valueItor.value());
+}
+
+void ProjectManager::batchComponentStatusChange(Jimmy::Connection connection, QJsonObject& jo)
+{
+    if (projectStatus_ != ProjectStatus::running)
+    {
+        return;
+    }
+
+    auto changesItor = jo.find("changes");
+    if ((changesItor == jo.end())||(!changesItor->isArray()))
+    {
+        LOGERROR(QStringLiteral("[%1:%2] changes is invalid")
+            .arg(__FUNCTION__)
+            .arg(__LINE__));
+
+        return;
+    }
+
+    //全部输入设置完成后每个订阅组件只触发一次,之后每一级同样合并
+    auto wave = make_shared<ComponentChangeWave>();
+    {
+        ThreadPool::WaveScope scope(wave.get());
+
+        foreach (const auto& item, changesItor->toArray())
+        {
+            //每项可以是 {"cid":%s,"value":%r} 或 {"h":%d,"v":%r}
+            auto change = item.toObject();
+            auto handleItor = change.find("h");
+            if (handleItor != change.end())
+            {
+                auto component = getComponent(handleItor->toInt(-1));
+                auto valueItor = change.find("v");
+                if ((component) && (valueItor != change.end()))
+                {
+                    component->setValue(connection, valueItor.value());
+                    continue;
+                }
+            }
+            else
+            {
+                auto cidItor = change.find("cid");
+                auto valueItor = change.find("value");
+                if ((cidItor != change.end()) && cidItor->isString() && (valueItor != change.end()))
+                {
+                    setComponentValue_(connection, cidItor->toString(), valueItor.value());
+                    continue;
+                }
+            }
+
+            LOGERROR(QStringLiteral("[%1:%2] batch change %3 is invalid")
+                .arg(__FUNCTION__)
+                .arg(__LINE__)
+                .arg(QString::fromUtf8(MessageCodec::toJson(change))));
+        }
+    }
+
+    threadPool.dispatchWave(wave);
+}
+
+void ProjectManager::setComponentValue_(Jimmy::Connection connection, const QString& cid, const QJsonValue& value)
+{
+    shared_ptr<CoreComponent> component = getComponent(cid);
     if (!component)
     {
         LOGERROR(QStringLiteral("[%1:%2] component %s is not exist")
             .arg(__FUNCTION__)
             .arg(__LINE__)
-            .arg(cidItor->toString()));
+            .arg(cid));
 
         return;
     }
 
-    component->setValue(connection,valueItor.value());
+    component->setValue(connection,value);
 }
 
 void ProjectManager::notify(Jimmy::Connection connection, QJsonObject& jo)
@@ -882,7 +1283,7 @@ void ProjectManager::notify(Jimmy::Connection connection, QJsonObject& jo)
         return;
     }
 
-    auto data = QJsonDocument(jo).toJson();
+    const QJsonObject& data = jo;
     auto itor = jo.find("userid");
     if (itor != jo.end())
     {
@@ -929,7 +1330,7 @@ void ProjectManager::reloadScript(Jimmy::Connection connection, QJsonObject& jo)
     {
         jo.insert(Result, Failed);
         jo.insert(Reason, "project is not running");
-        gActionSimulationServer.getUserManager()->answerMessage(connection, QJsonDocument(jo).toJson(QJsonDocument::Compact));
+        gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
         return;
     }
 
@@ -938,7 +1339,7 @@ void ProjectManager::reloadScript(Jimmy::Connection connection, QJsonObject& jo)
     {
         jo.insert(Result, Failed);
         jo.insert(Reason, "role is invalid");
-        gActionSimulationServer.getUserManager()->answerMessage(connection, QJsonDocument(jo).toJson(QJsonDocument::Compact));
+        gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
         return;
     }
 
@@ -960,10 +1361,124 @@ void ProjectManager::reloadScript(Jimmy::Connection connection, QJsonObject& jo)
         jo.insert(Result, Failed);
         jo.insert(Reason, "load script failed");
     }
-    gActionSimulationServer.getUserManager()->answerMessage(connection, QJsonDocument(jo).toJson(QJsonDocument::Compact));
+    gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
     return;
 }
 
+void ProjectManager::resync(Jimmy::Connection connection, QJsonObject& jo)
+{
+    Q_UNUSED(jo)
+    auto userInfo = gActionSimulationServer.getUserManager()->getUserInfo(connection);
+    if(!userInfo)
+    {
+        return;
+    }
+
+    //完整状态放在一条消息中,避免再次触发发送队列消息数上限
+    QJsonObject joRet;
+    joRet.insert("action", "resync");
+    joRet.insert(Result, Succeed);
+
+    //快照在该用户的组播发布锁内取得,seq 之前的数据报都已反映在 values 中,客户端只需应用序号更大的数据报
+    uint64_t seq(0);
+    bool multicast = gActionSimulationServer.snapshotMulticast(userInfo->userId, [&]()
+    {
+        if (userInfo->componentHandle)
+        {
+            //请求了句柄的连接按句柄顺序返回数组,下标即句柄
+            QJsonArray values;
+            foreach (const auto& component, componentHandles_)
+            {
+                values.append(component->getValue(userInfo->userId));
+            }
+            joRet.insert("values", values);
+        }
+        else
+        {
+            QJsonObject values;
+            foreach (auto& component ,components_.values())
+            {
+                values.insert(component->getID(), component->getValue(userInfo->userId));
+            }
+            joRet.insert("values", values);
+        }
+    }, seq);
+
+    if (multicast)
+    {
+        joRet.insert("seq", static_cast<qint64>(seq));
+    }
+    gActionSimulationServer.getUserManager()->answerMessage(connection, joRet);
+}
+
+void ProjectManager::getConnectionStatus(Jimmy::Connection connection, QJsonObject& jo)
+{
+    auto userInfo = gActionSimulationServer.getUserManager()->getUserInfo(connection);
+    if(!userInfo)
+    {
+        return;
+    }
+
+    if(userInfo->role != UserRole::Administrator)
+    {
+        jo.insert(Result, Failed);
+        jo.insert(Reason, "insufficient privileges");
+        gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
+        return;
+    }
+
+    QJsonArray connections;
+    foreach (const auto& item, gActionSimulationServer.getConnectionStatus())
+    {
+        QJsonObject joConnection;
+        joConnection.insert("connection", static_cast<qint64>(item.connectionId));
+        joConnection.insert("client", item.clientInfo);
+
+        auto itemUser = gActionSimulationServer.getUserManager()->getUserInfo(Connection{item.connectionId});
+        if(itemUser)
+        {
+            joConnection.insert("userid", static_cast<qint64>(itemUser->userId.userID));
+            joConnection.insert("role", static_cast<qint64>(itemUser->role));
+            joConnection.insert("user_throttled_messages", static_cast<qint64>(gActionSimulationServer.getUserManager()->getThrottledMessages(itemUser->userId)));
+        }
+
+        joConnection.insert("queue_messages", static_cast<qint64>(item.queueMessages));
+        joConnection.insert("queue_bytes", static_cast<qint64>(item.queueBytes));
+        joConnection.insert("dropped_messages", static_cast<qint64>(item.droppedMessages));
+        joConnection.insert("dropped_bytes", static_cast<qint64>(item.droppedBytes));
+        joConnection.insert("resync_times", static_cast<qint64>(item.resyncTimes));
+        joConnection.insert("conflated_messages", static_cast<qint64>(item.conflatedMessages));
+        joConnection.insert("throttled_messages", static_cast<qint64>(item.throttledMessages));
+        joConnection.insert("codec", gActionSimulationServer.getConnectionCodec(item.connectionId));
+
+        if(gActionSimulationServer.getUserManager()->isGateway(item.connectionId))
+        {
+            joConnection.insert("sessions", static_cast<qint64>(gActionSimulationServer.getUserManager()->getSessions(item.connectionId).size()));
+        }
+        connections.append(joConnection);
+    }
+
+    jo.insert(Result, Succeed);
+    jo.insert("value", connections);
+    gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
+}
+
+void ProjectManager::closeSession(Jimmy::Connection connection, QJsonObject& jo)
+{
+    if(connection.SessionID == 0)
+    {
+        jo.insert(Result, Failed);
+        jo.insert(Reason, "sid is not exist");
+        gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
+        return;
+    }
+
+    gActionSimulationServer.getUserManager()->closeSession(connection);
+
+    jo.insert(Result, Succeed);
+    gActionSimulationServer.getUserManager()->answerMessage(connection, jo);
+}
+
 void ProjectManager::generateSubscriptionComponents()
 {
     subscriptionComponents_.clear();
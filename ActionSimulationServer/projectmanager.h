@@ -35,11 +35,17 @@ SOFTWARE.
 #include <variant>
 #include <QQueue>
 #include <QPair>
+#include <QSet>
 #include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <vector>
+#include <atomic>
 #include "boardcast.h"
 #include "corecomponent.h"
 #include "scheduledtaskpool.h"
 #include "threadpool.h"
+#include "writerpreferringmutex.h"
 
 
 enum class ProjectStatus
@@ -78,6 +84,12 @@ public:
 
     void pushMessage(size_t connection_id,const std::string& message);
 
+    //管理端口上的消息,控制命令由独立线程处理,不必排在大量组件状态变化之后
+    void pushControlMessage(size_t connection_id,const std::string& message);
+
+    //连接发送队列超限后重新发送完整状态
+    void resyncConnection(size_t connection_id);
+
     void run();
     void stop();
 
@@ -94,6 +106,8 @@ public:
     void triggerComponentChangeEvent(const Jimmy::ComponentChangeEvent& componentChangeEvent);
 
     std::shared_ptr<Jimmy::CoreComponent> getComponent(const QString& cid);
+    //句柄无效时返回 nullptr
+    std::shared_ptr<Jimmy::CoreComponent> getComponent(int handle);
 
     QStringList getIntersectBoardcast(Jimmy::User userid,const QStringList& boardcast);
 private:
@@ -114,15 +128,23 @@ private:
     void queryAllValue(Jimmy::Connection connection, QJsonObject& jo);
     void queryValue(Jimmy::Connection connection, QJsonObject& jo);
     void componentStatusChange(Jimmy::Connection connection, QJsonObject& jo);
+    void setComponentValue_(Jimmy::Connection connection, const QString& cid, const QJsonValue& value);
+    void batchComponentStatusChange(Jimmy::Connection connection, QJsonObject& jo);
 
     void notify(Jimmy::Connection connection, QJsonObject& jo);
     void reloadScript(Jimmy::Connection connection, QJsonObject& jo);
+
+    void resync(Jimmy::Connection connection, QJsonObject& jo);
+    void getConnectionStatus(Jimmy::Connection connection, QJsonObject& jo);
+
+    void closeSession(Jimmy::Connection connection, QJsonObject& jo);
 private:
     static const char* const Action;
     static const char* const Succeed;
     static const char* const Failed;
     static const char* const Result;
     static const char* const Reason;
+    static const char* const SessionID;
 private:
     void loadProject_();
     Jimmy::ErrorCode runProject_();
@@ -137,6 +159,7 @@ private:
     std::shared_ptr<Jimmy::CoreComponent> createComponent(Jimmy::ComponentType type);
 
     QHash<QString, std::shared_ptr<Jimmy::CoreComponent>> components_;
+    QVector<std::shared_ptr<Jimmy::CoreComponent>> componentHandles_;          //按句柄下标索引
     QHash<QString, std::shared_ptr<QStringList>> subscriptionComponents_;
     QHash<QString, std::shared_ptr<QStringList>> boardcastRespondComponent_;
     Boardcast boardcast_;
@@ -149,19 +172,39 @@ private:
 private:
     void actionFailed(Jimmy::Connection connection,const QString& action,const QString& reason);
 
-    void disposeCommand(Jimmy::Connection connection, const QString& message);
+    //消息保持收到的 UTF-8 数据,不再转换为 QString
+    void disposeCommand(Jimmy::Connection connection, const std::string& message);
+    bool disposeComponentStatusChange_(Jimmy::Connection connection, const std::string& message);
+    void appendMessage_(const Jimmy::Connection& connection, const std::string& message);
 
-    void commandTcpDataThread();
-    std::thread commandTCPDataThread_;
+    //数据命令按连接号分配到多个线程,同一连接(含其上的网关会话)的命令始终在同一线程上按顺序执行
+    struct CommandShard
+    {
+        QQueue<QPair<Jimmy::Connection,std::string>> msgData;
+        std::mutex lockMsgData;
+        std::condition_variable cvMsgData;
+        std::thread thread;
+    };
+
+    void commandTcpDataThread(CommandShard* shard);
+    std::vector<std::unique_ptr<CommandShard>> commandShards_;
+
+    void commandControlThread();
+    std::thread commandControlThread_;
 
     void initializesDispatcher();
     QHash<QString, std::function<void(Jimmy::Connection,QJsonObject&)>> commandDispatcher_;
 
-    bool isRun_;
+    //加载、运行、停止项目和重新加载脚本独占执行,其余命令在各线程上并行执行
+    QSet<QString> exclusiveActions_;
+    //数据命令持续不断时控制命令仍能及时拿到写锁
+    Jimmy::WriterPreferringMutex lockCommand_;
+
+    std::atomic_bool isRun_;
 
-    QQueue<QPair<Jimmy::Connection,QString>> msgData_;
-    std::mutex lockMsgData_;
-    std::condition_variable cvMsgData_;
+    QQueue<QPair<Jimmy::Connection,std::string>> controlData_;
+    std::mutex lockControlData_;
+    std::condition_variable cvControlData_;
 private:
     uint32_t min_timer_interval_;
     uint32_t default_timer_interval_;
@@ -302,6 +302,26 @@ void TeamMasterComponent::onAction(User userid,const QString& trigger,const QJso
     analysisResult(userid,results.value());
 }
 
+void TeamMasterComponent::onBatchAction(User userid,const QJsonObject& triggers,const QString& /*trigger*/,const QJsonValue& /*value*/)
+{
+    if(!actionScript_)
+    {
+        LOGERROR(QStringLiteral("[%1:%2] component:{%3} is not start")
+            .arg(__FUNCTION__)
+            .arg(__LINE__)
+            .arg(getID()));
+
+        return;
+    }
+    auto results = actionScript_->onAction(collectInputs(userid,triggers));
+    if(!results)
+    {
+        return;
+    }
+
+    analysisResult(userid,results.value());
+}
+
 void TeamMasterComponent::onTime(User userid,size_t counter)
 {
     if(!actionScript_)
@@ -445,6 +465,20 @@ QJsonObject TeamMasterComponent::collectInputs(User userid,const QString& trigge
     return jo;
 }
 
+//参数格式与 NormalComponent 的合并事件相同,从设备值等由广播触发的参数提供
+QJsonObject TeamMasterComponent::collectInputs(User userid,const QJsonObject& triggers)
+{
+    QJsonObject jo = collectInputs(userid,CommonConst::Boardcast,QJsonValue());
+    jo.insert("_trigger", CommonConst::BatchEvent);
+    jo.insert("_triggers", triggers);
+    for (auto itor = triggers.begin(); itor != triggers.end(); ++itor)
+    {
+        jo.insert(itor.key(), itor.value());
+    }
+
+    return jo;
+}
+
 void TeamMasterComponent::getRelationParams(User userid,const QString& trigger,QJsonObject& jo)
 {
     auto items = getSubscription() + getReference();
@@ -510,7 +544,7 @@ void TeamMasterComponent::setValue_(User userid,const QJsonObject& value)
 
     foreach(auto item,valueChanged)
     {
-        gActionSimulationServer.getUserManager()->sendUserMessage(userid,true,getAnswerValue(item.first,item.second));
+        gActionSimulationServer.getUserManager()->sendUserMessage(userid,true,getAnswerValue(item.first,item.second),item.first);
         gActionSimulationServer.getProjectManager()->notifyComponentChange(userid,item.first,item.second);
     }
 }
@@ -577,12 +611,11 @@ void TeamMasterComponent::analysisResult(User userid, const QJsonObject& result)
     }
 }
 
-QString TeamMasterComponent::getAnswerValue(const QString& slaveID,const QJsonValue& value)
+AnswerValue TeamMasterComponent::getAnswerValue(const QString& slaveID,const QJsonValue& value)
 {
-    QJsonObject jo;
-    jo.insert("cid", slaveID);
-    jo.insert("value", value);
-    return QJsonDocument(jo).toJson(QJsonDocument::Compact);
+    //从属组件同样是项目中的组件,使用其自身的句柄
+    auto slave = gActionSimulationServer.getProjectManager()->getComponent(slaveID);
+    return makeAnswerValue(slaveID, slave ? slave->getHandle() : -1, value);
 }
 
 QJsonValue TeamMasterComponent::getValue(User userid,const QString& slaveID)
@@ -37,6 +37,7 @@ public:
 
     void onBoardcast(User userid) override;
     void onAction(User userid,const QString& trigger,const QJsonValue& value) override;
+    void onBatchAction(User userid,const QJsonObject& triggers,const QString& trigger,const QJsonValue& value) override;
     void onTime(User userid,size_t counter) override;
     void onLoop(User /*userid*/,const QJsonValue& /*value*/) override {};
 
@@ -59,11 +60,12 @@ private:
     void setReference(const QStringList& reference) { reference_ = reference;reference_.removeDuplicates();}
     void setRespondBoardcast(const QStringList& boardcast) { respondBoardcast_ = boardcast;}
 private:
-    QString getAnswerValue(const QString& slaveI,const QJsonValue& value);
+    AnswerValue getAnswerValue(const QString& slaveI,const QJsonValue& value);
     void setTeam(const QString& team) { team_ = team;}
     QJsonObject collectInputs();
     QJsonObject collectInputs(User userid,size_t counter);
     QJsonObject collectInputs(User userid,const QString& trigger,const QJsonValue& value);
+    QJsonObject collectInputs(User userid,const QJsonObject& triggers);
 
     std::shared_ptr<UserValue> getUserValue_(Jimmy::User userID,bool create_on_not_exist);
 
@@ -9,6 +9,85 @@ using namespace std;
 namespace Jimmy
 {
 
+static thread_local ComponentChangeWave* currentWave = nullptr;
+
+ThreadPool::WaveScope::WaveScope(ComponentChangeWave* wave)
+    :previous_(currentWave)
+{
+    currentWave = wave;
+}
+
+ThreadPool::WaveScope::~WaveScope()
+{
+    currentWave = previous_;
+}
+
+bool ThreadPool::mergeIntoWave(const Jimmy::ComponentChangeEvent& componentChangeEvent)
+{
+    if (currentWave == nullptr)
+    {
+        return false;
+    }
+
+    //同一订阅组件的多个触发来源合并为一个事件,trigger / value 保留最后一个来源
+    lock_guard<mutex> lg(currentWave->lock);
+    auto itor = currentWave->events.find(componentChangeEvent.cid);
+    if (itor == currentWave->events.end())
+    {
+        currentWave->order.push_back(componentChangeEvent.cid);
+        currentWave->events.insert(componentChangeEvent.cid, componentChangeEvent);
+        return true;
+    }
+
+    if (itor->triggers.isEmpty())
+    {
+        itor->triggers.insert(itor->trigger, itor->value);
+    }
+    itor->triggers.insert(componentChangeEvent.trigger, componentChangeEvent.value);
+    itor->trigger = componentChangeEvent.trigger;
+    itor->value = componentChangeEvent.value;
+    return true;
+}
+
+void ThreadPool::dispatchWave(const std::shared_ptr<ComponentChangeWave>& wave)
+{
+    QList<ComponentChangeEvent> events;
+    {
+        lock_guard<mutex> lg(wave->lock);
+        foreach (const auto& cid, wave->order)
+        {
+            auto componentChangeEvent = wave->events.value(cid);
+
+            //同一来源多次变化只保留最后的值,仍按普通事件触发
+            if (componentChangeEvent.triggers.size() < 2)
+            {
+                componentChangeEvent.triggers = QJsonObject();
+            }
+            componentChangeEvent.wave = wave;
+            events.push_back(componentChangeEvent);
+        }
+
+        wave->order.clear();
+        wave->events.clear();
+        wave->running = static_cast<size_t>(events.size());
+    }
+
+    notifyComponentChange(events);
+}
+
+void ThreadPool::finishWaveEvent_(const std::shared_ptr<ComponentChangeWave>& wave)
+{
+    {
+        lock_guard<mutex> lg(wave->lock);
+        if (--wave->running > 0)
+        {
+            return;
+        }
+    }
+
+    dispatchWave(wave);
+}
+
 ThreadPool::ThreadPool()
     :is_run_(false)
 {
@@ -63,6 +142,21 @@ void ThreadPool::notifyComponentChange(const Jimmy::ComponentChangeEvent& compon
     evInvokeChain_.notify_all();
 }
 
+void ThreadPool::notifyComponentChange(const QList<Jimmy::ComponentChangeEvent>& componentChangeEvents)
+{
+    if (componentChangeEvents.isEmpty())
+    {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lg(lockInvokeChain_);
+        waitingInvokeList_.append(componentChangeEvents);
+    }
+
+    evInvokeChain_.notify_all();
+}
+
 void ThreadPool::invokeChain()
 {
     ComponentChangeEvent componentChangeEvent;
@@ -90,28 +184,51 @@ void ThreadPool::invokeChain()
                 .arg(__LINE__)
                 .arg(componentChangeEvent.cid));
 
+            if (componentChangeEvent.wave)
+            {
+                finishWaveEvent_(componentChangeEvent.wave);
+            }
             return;
         }
 
-        if (componentChangeEvent.trigger.compare(CommonConst::TimerEvent)==0)
+        //batch 波次中的事件引起的变化归入同一波,这一级全部执行完后再合并触发下一级
         {
-            component->onTime(componentChangeEvent.userid,componentChangeEvent.counter);
+            WaveScope scope(componentChangeEvent.wave.get());
+            invokeEvent_(component, componentChangeEvent);
         }
-        else if ((componentChangeEvent.trigger.compare(CommonConst::LoopEvent)==0)
-             ||(componentChangeEvent.trigger.compare(CommonConst::OrderEvent)==0))
-        {
-            component->onLoop(componentChangeEvent.userid, componentChangeEvent.value);
-        }
-        else if (componentChangeEvent.trigger.compare(CommonConst::Boardcast) == 0)
-        {
-            component->onBoardcast(componentChangeEvent.userid);
-        }
-        else
+
+        if (componentChangeEvent.wave)
         {
-            component->onAction(componentChangeEvent.userid,componentChangeEvent.trigger, componentChangeEvent.value);
+            finishWaveEvent_(componentChangeEvent.wave);
+            componentChangeEvent.wave.reset();
         }
     }
 }
 
+void ThreadPool::invokeEvent_(const std::shared_ptr<CoreComponent>& component, const ComponentChangeEvent& componentChangeEvent)
+{
+    if (componentChangeEvent.trigger.compare(CommonConst::TimerEvent)==0)
+    {
+        component->onTime(componentChangeEvent.userid,componentChangeEvent.counter);
+    }
+    else if ((componentChangeEvent.trigger.compare(CommonConst::LoopEvent)==0)
+         ||(componentChangeEvent.trigger.compare(CommonConst::OrderEvent)==0))
+    {
+        component->onLoop(componentChangeEvent.userid, componentChangeEvent.value);
+    }
+    else if (componentChangeEvent.trigger.compare(CommonConst::Boardcast) == 0)
+    {
+        component->onBoardcast(componentChangeEvent.userid);
+    }
+    else if (!componentChangeEvent.triggers.isEmpty())
+    {
+        component->onBatchAction(componentChangeEvent.userid,componentChangeEvent.triggers,componentChangeEvent.trigger, componentChangeEvent.value);
+    }
+    else
+    {
+        component->onAction(componentChangeEvent.userid,componentChangeEvent.trigger, componentChangeEvent.value);
+    }
+}
+
 
 }
@@ -6,11 +6,24 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <QHash>
+#include <QStringList>
 #include "commonstruct.h"
 
 namespace Jimmy
 {
 
+class CoreComponent;
+
+//batch 命令引起的一波组件变化,每一级产生的变化先按订阅组件合并,这一级全部执行完后每个订阅组件只触发一次
+struct ComponentChangeWave
+{
+    std::mutex lock;
+    QStringList order;
+    QHash<QString, ComponentChangeEvent> events;
+    size_t running{0};                              //当前一级尚未执行完的事件数
+};
+
 class ThreadPool
 {
 public:
@@ -21,7 +34,30 @@ public:
     void stop();
 
     void notifyComponentChange(const Jimmy::ComponentChangeEvent& componentChangeEvent);
+    void notifyComponentChange(const QList<Jimmy::ComponentChangeEvent>& componentChangeEvents);
+
+    //在作用域内当前线程产生的组件变化合并到 wave,离开作用域(包括异常)时恢复
+    class WaveScope
+    {
+    public:
+        explicit WaveScope(ComponentChangeWave* wave);
+        ~WaveScope();
+
+        WaveScope(const WaveScope&) = delete;
+        WaveScope& operator=(const WaveScope&) = delete;
+    private:
+        ComponentChangeWave* previous_;
+    };
+
+    //当前线程在某一波中时把事件合并进去并返回 true
+    static bool mergeIntoWave(const Jimmy::ComponentChangeEvent& componentChangeEvent);
+
+    //把 wave 中已合并的事件作为下一级发出,没有事件时这一波结束
+    void dispatchWave(const std::shared_ptr<ComponentChangeWave>& wave);
 private:
+    void invokeEvent_(const std::shared_ptr<CoreComponent>& component, const ComponentChangeEvent& componentChangeEvent);
+    void finishWaveEvent_(const std::shared_ptr<ComponentChangeWave>& wave);
+
     bool is_run_;
 
     std::condition_variable evInvokeChain_;
@@ -26,8 +26,13 @@ SOFTWARE.
 #include "usermanager.h"
 #include "actionsimulationserver.h"
 #include "projectmanager.h"
+#include "appconfig.h"
+#include "corecomponent.h"
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <boost/bimap/support/lambda.hpp>
 #include <functional>
+#include <algorithm>
 
 using namespace std;
 using namespace Jimmy;
@@ -50,7 +55,17 @@ User getVisitorID()
     return User{ret};
 }
 
+//网关会话的消息加上 "sid",网关据此转发给对应的会话
+QJsonObject addSessionID(const QJsonObject& message, size_t sessionID)
+{
+    QJsonObject ret = message;
+    ret.insert("sid", static_cast<qint64>(sessionID));
+    return ret;
+}
+
 UserManager::UserManager()
+    :userIngressRate_(gActionSimulationServer.getAppConfig()->getUserIngressRate())
+    , userIngressBurst_(gActionSimulationServer.getAppConfig()->getUserIngressBurst())
 {
     gActionSimulationServer.registerAppendConnnection(std::bind(&UserManager::registerConnection,this,placeholders::_1));
     gActionSimulationServer.registerRemoveConnnection(std::bind(&UserManager::disconnect,this,placeholders::_1));
@@ -106,32 +121,184 @@ void UserManager::login(Connection connection,User userID,size_t role)
 
 void UserManager::disconnect(size_t connection)
 {
-    User userID(0);
+    QVector<User> vUserID;
     {
         lock_guard<shared_mutex> lg(lockUser_);
+        gateways_.remove(connection);
+
+        //网关连接断开时其上所有会话一并移除
+        auto iter = userInfo_.lower_bound(UserInfo(Connection{connection,0}));
+        while ((iter != userInfo_.end()) && (iter->connectId.ConnectionID == connection))
         {
-            UserInfo user(Connection{connection});
+            vUserID.push_back(iter->userId);
+            iter = userInfo_.erase(iter);
+        }
+    }
 
-            auto iter = userInfo_.find(user);
-            if (iter != userInfo_.end())
-            {
-                userID = iter->userId;
-                userInfo_.erase(iter);
-            }
+    removeUsers_(vUserID);
+}
+
+User UserManager::registerSession(Connection connection)
+{
+    UserInfo user(connection);
+    {
+        shared_lock<shared_mutex> lg(lockUser_);
+        auto iter = userInfo_.find(user);
+        if (iter != userInfo_.end())
+        {
+            return iter->userId;
         }
+    }
+
+    lock_guard<shared_mutex> lg(lockUser_);
+    auto iter = userInfo_.find(user);
+    if (iter != userInfo_.end())
+    {
+        return iter->userId;
+    }
 
-        if(userID.userID > 0)
+    user.userId = getVisitorID();
+    user.role = static_cast<size_t>(UserRole::Normal);
+    userInfo_.insert(user);
+    return user.userId;
+}
+
+void UserManager::closeSession(Connection connection)
+{
+    QVector<User> vUserID;
+    {
+        lock_guard<shared_mutex> lg(lockUser_);
+        auto iter = userInfo_.find(UserInfo(connection));
+        if (iter != userInfo_.end())
         {
-            auto& userView = userInfo_.get<UserId>();
-            auto iter = userView.find(userID);
-            if(iter != userView.end())
+            vUserID.push_back(iter->userId);
+            userInfo_.erase(iter);
+        }
+    }
+
+    removeUsers_(vUserID);
+}
+
+void UserManager::setGateway(size_t connection)
+{
+    lock_guard<shared_mutex> lg(lockUser_);
+    gateways_.insert(connection);
+}
+
+bool UserManager::isGateway(size_t connection)
+{
+    shared_lock<shared_mutex> lg(lockUser_);
+    return gateways_.contains(connection);
+}
+
+void UserManager::setComponentHandle(Connection connection)
+{
+    lock_guard<shared_mutex> lg(lockUser_);
+    auto iter = userInfo_.find(UserInfo(connection));
+    if (iter != userInfo_.end())
+    {
+        userInfo_.modify(iter,[](UserInfo& e) { e.componentHandle = true; });
+    }
+}
+
+QVector<size_t> UserManager::getSessions(size_t connection)
+{
+    QVector<size_t> vRet;
+    shared_lock<shared_mutex> lg(lockUser_);
+    auto iter = userInfo_.upper_bound(UserInfo(Connection{connection,0}));
+    while ((iter != userInfo_.end()) && (iter->connectId.ConnectionID == connection))
+    {
+        vRet.push_back(iter->connectId.SessionID);
+        ++iter;
+    }
+
+    return vRet;
+}
+
+bool UserManager::acquireIngress(size_t connection)
+{
+    if ((userIngressRate_ == 0) || (gActionSimulationServer.getProjectManager()->getProjectType() == ProjectType::SingleUser))
+    {
+        return true;
+    }
+
+    User userID;
+    {
+        shared_lock<shared_mutex> lg(lockUser_);
+        if (gateways_.contains(connection))
+        {
+            return true;
+        }
+
+        auto iter = userInfo_.find(UserInfo(Connection{connection}));
+        if (iter == userInfo_.end())
+        {
+            return true;
+        }
+
+        userID = iter->userId;
+    }
+
+    auto& shard = getIngressShard_(userID);
+    lock_guard<mutex> lg(shard.lock);
+    auto itor = shard.limits.find(userID);
+    if (itor == shard.limits.end())
+    {
+        itor = shard.limits.insert(userID, IngressLimit());
+        itor->bucket.reset(userIngressRate_, userIngressBurst_);
+    }
+
+    if (itor->bucket.consume())
+    {
+        return true;
+    }
+
+    ++itor->throttledMessages;
+    return false;
+}
+
+size_t UserManager::getThrottledMessages(User userID)
+{
+    auto& shard = getIngressShard_(userID);
+    lock_guard<mutex> lg(shard.lock);
+    auto itor = shard.limits.find(userID);
+    return (itor == shard.limits.end()) ? 0 : itor->throttledMessages;
+}
+
+//用户的最后一个连接或会话移除后释放该用户的组件值
+void UserManager::removeUsers_(const QVector<User>& vUserID)
+{
+    if(gActionSimulationServer.getProjectManager()->getProjectType() == ProjectType::SingleUser)
+    {
+        return;
+    }
+
+    QVector<User> vRemove;
+    {
+        shared_lock<shared_mutex> lg(lockUser_);
+        auto& userView = userInfo_.get<UserId>();
+        foreach (auto userID, vUserID)
+        {
+            if((userID.userID > 0) && (userView.find(userID) != userView.end()))
+            {
+                continue;
+            }
+
+            if(std::find_if(vRemove.begin(), vRemove.end(), [&userID](const User& item){ return item.userID == userID.userID; }) == vRemove.end())
             {
-                return;
+                vRemove.push_back(userID);
             }
         }
     }
 
-    if(gActionSimulationServer.getProjectManager()->getProjectType() != ProjectType::SingleUser)
+    foreach (auto userID, vRemove)
+    {
+        auto& shard = getIngressShard_(userID);
+        lock_guard<mutex> lg(shard.lock);
+        shard.limits.remove(userID);
+    }
+
+    foreach (auto userID, vRemove)
     {
         gActionSimulationServer.getProjectManager()->removeUser(userID);
     }
@@ -188,58 +355,114 @@ QVector<UserInfo> UserManager::getConnectIdbyUsers_(const QVector<User>& vUserID
     return vRet;
 }
 
-void UserManager::answerMessage(Connection connection, const QString& message)
+void UserManager::answerMessage(Connection connection, const QJsonObject& message)
+{
+    if (connection.SessionID == 0)
+    {
+        gActionSimulationServer.sendNetMessage(connection.ConnectionID,message);
+        return;
+    }
+
+    gActionSimulationServer.sendNetMessage(connection.ConnectionID,addSessionID(message,connection.SessionID));
+}
+
+void UserManager::answerMessage(const UserInfo& userInfo, const AnswerValue& message)
 {
-    gActionSimulationServer.sendNetMessage(connection.ConnectionID,message);
+    if (userInfo.componentHandle && message.hasHandle())
+    {
+        answerMessage(userInfo.connectId, message.handleMessage());
+        return;
+    }
+
+    answerMessage(userInfo.connectId, message.message);
 }
 
-void UserManager::sendUserMessage(Jimmy::User userid, bool admin_Only,const QString& message)
+void UserManager::sendUserMessage(Jimmy::User userid, bool admin_Only,const QJsonObject& message,const QString& conflateKey)
 {
     switch (gActionSimulationServer.getProjectManager()->getProjectType())
     {
     case ProjectType::SingleUser:
     {
-        return sendMessage(admin_Only,message);
+        return sendMessage(admin_Only,message,conflateKey);
     }
     case ProjectType::MultiUser:
     {
-        return sendUserMessage_(userid,admin_Only,message);
+        return sendUserMessage_(userid,admin_Only,message,conflateKey);
     }
     }
 }
 
-void UserManager::sendUserMessage(Jimmy::User userid,bool admin_Only,Jimmy::Connection excludeConnection,const QString& message)
+void UserManager::sendUserMessage(Jimmy::User userid,bool admin_Only,Jimmy::Connection excludeConnection,const QJsonObject& message,const QString& conflateKey)
 {
     switch (gActionSimulationServer.getProjectManager()->getProjectType())
     {
     case ProjectType::SingleUser:
     {
-        return sendMessage(admin_Only,excludeConnection,message);
+        return sendMessage(admin_Only,excludeConnection,message,conflateKey);
     }
     case ProjectType::MultiUser:
     {
-        return sendUserMessage_(userid,admin_Only,excludeConnection,message);
+        return sendUserMessage_(userid,admin_Only,excludeConnection,message,conflateKey);
     }
     }
 }
 
-void UserManager::sendRoleMessage(size_t role, const QString& message)
+void UserManager::sendUserMessage(Jimmy::User userid, bool admin_Only,const AnswerValue& message,const QString& conflateKey)
 {
-    shared_lock<shared_mutex> lg(lockUser_);
+    switch (gActionSimulationServer.getProjectManager()->getProjectType())
+    {
+    case ProjectType::SingleUser:
+    {
+        return sendMessage(admin_Only,message.message,conflateKey,&message);
+    }
+    case ProjectType::MultiUser:
     {
+        return sendUserMessage_(userid,admin_Only,message.message,conflateKey,&message);
+    }
+    }
+}
+
+void UserManager::sendUserMessage(Jimmy::User userid,bool admin_Only,Jimmy::Connection excludeConnection,const AnswerValue& message,const QString& conflateKey)
+{
+    switch (gActionSimulationServer.getProjectManager()->getProjectType())
+    {
+    case ProjectType::SingleUser:
+    {
+        return sendMessage(admin_Only,excludeConnection,message.message,conflateKey,&message);
+    }
+    case ProjectType::MultiUser:
+    {
+        return sendUserMessage_(userid,admin_Only,excludeConnection,message.message,conflateKey,&message);
+    }
+    }
+}
+
+void UserManager::sendRoleMessage(size_t role, const QJsonObject& message)
+{
+    QVector<UserInfo> vUserInfo;
+    {
+        shared_lock<shared_mutex> lg(lockUser_);
         auto& roleView = userInfo_.get<RoleInfo>();
         auto p = roleView.equal_range(role);
         for (auto it = p.first; it != p.second; ++it)
         {
-            gActionSimulationServer.sendNetMessage(it->connectId.ConnectionID,message);
+            if(!isBroadcastTarget_(*it))
+            {
+                continue;
+            }
+
+            vUserInfo.push_back(*it);
         }
     }
+
+    sendConnectionMessage_(vUserInfo,message,QString(),nullptr);
 }
 
-void UserManager::sendRoleMessage(size_t role,Connection excludeConnection, const QString& message)
+void UserManager::sendRoleMessage(size_t role,Connection excludeConnection, const QJsonObject& message)
 {
-    shared_lock<shared_mutex> lg(lockUser_);
+    QVector<UserInfo> vUserInfo;
     {
+        shared_lock<shared_mutex> lg(lockUser_);
         auto& roleView = userInfo_.get<RoleInfo>();
         auto p = roleView.equal_range(role);
         for (auto it = p.first; it != p.second; ++it)
@@ -249,16 +472,24 @@ void UserManager::sendRoleMessage(size_t role,Connection excludeConnection, cons
                 continue;
             }
 
-            gActionSimulationServer.sendNetMessage(it->connectId.ConnectionID,message);
+            if(!isBroadcastTarget_(*it))
+            {
+                continue;
+            }
+
+            vUserInfo.push_back(*it);
         }
     }
+
+    sendConnectionMessage_(vUserInfo,message,QString(),nullptr);
 }
 
 
-void UserManager::sendUserMessage_(User userid, bool admin_Only,const QString& message)
+void UserManager::sendUserMessage_(User userid, bool admin_Only,const QJsonObject& message,const QString& conflateKey,const AnswerValue* answer)
 {
-    shared_lock<shared_mutex> lg(lockUser_);
+    QVector<UserInfo> vUserInfo;
     {
+        shared_lock<shared_mutex> lg(lockUser_);
         auto& userView = userInfo_.get<UserId>();
         auto p = userView.equal_range(userid);
         for (auto it = p.first; it != p.second; ++it)
@@ -268,15 +499,23 @@ void UserManager::sendUserMessage_(User userid, bool admin_Only,const QString& m
                 continue;
             }
 
-            gActionSimulationServer.sendNetMessage(it->connectId.ConnectionID,message);
+            if(!isBroadcastTarget_(*it))
+            {
+                continue;
+            }
+
+            vUserInfo.push_back(*it);
         }
     }
+
+    sendConnectionMessage_(vUserInfo,message,conflateKey,answer);
 }
 
-void UserManager::sendUserMessage_(User userid,bool admin_Only,Connection excludeConnection, const QString& message)
+void UserManager::sendUserMessage_(User userid,bool admin_Only,Connection excludeConnection, const QJsonObject& message,const QString& conflateKey,const AnswerValue* answer)
 {
-    shared_lock<shared_mutex> lg(lockUser_);
+    QVector<UserInfo> vUserInfo;
     {
+        shared_lock<shared_mutex> lg(lockUser_);
         auto& userView = userInfo_.get<UserId>();
         auto p = userView.equal_range(userid);
         for (auto it = p.first; it != p.second; ++it)
@@ -291,15 +530,23 @@ void UserManager::sendUserMessage_(User userid,bool admin_Only,Connection exclud
                 continue;
             }
 
-            gActionSimulationServer.sendNetMessage(it->connectId.ConnectionID,message);
+            if(!isBroadcastTarget_(*it))
+            {
+                continue;
+            }
+
+            vUserInfo.push_back(*it);
         }
     }
+
+    sendConnectionMessage_(vUserInfo,message,conflateKey,answer);
 }
 
-void UserManager::sendMessage(bool admin_Only,const QString& message)
+void UserManager::sendMessage(bool admin_Only,const QJsonObject& message,const QString& conflateKey,const AnswerValue* answer)
 {
-    shared_lock<shared_mutex> lg(lockUser_);
+    QVector<UserInfo> vUserInfo;
     {
+        shared_lock<shared_mutex> lg(lockUser_);
         for (auto it = userInfo_.cbegin(); it != userInfo_.cend(); ++it)
         {
             if(admin_Only && (it->role != static_cast<int>(UserRole::Administrator)))
@@ -307,15 +554,23 @@ void UserManager::sendMessage(bool admin_Only,const QString& message)
                 continue;
             }
 
-            gActionSimulationServer.sendNetMessage(it->connectId.ConnectionID,message);
+            if(!isBroadcastTarget_(*it))
+            {
+                continue;
+            }
+
+            vUserInfo.push_back(*it);
         }
     }
+
+    sendConnectionMessage_(vUserInfo,message,conflateKey,answer);
 }
 
-void UserManager::sendMessage(bool admin_Only,Jimmy::Connection excludeConnection, const QString& message)
+void UserManager::sendMessage(bool admin_Only,Jimmy::Connection excludeConnection, const QJsonObject& message,const QString& conflateKey,const AnswerValue* answer)
 {
-    shared_lock<shared_mutex> lg(lockUser_);
+    QVector<UserInfo> vUserInfo;
     {
+        shared_lock<shared_mutex> lg(lockUser_);
         for (auto it = userInfo_.cbegin(); it != userInfo_.cend(); ++it)
         {
             if(it->connectId == excludeConnection)
@@ -328,15 +583,72 @@ void UserManager::sendMessage(bool admin_Only,Jimmy::Connection excludeConnectio
                 continue;
             }
 
-            gActionSimulationServer.sendNetMessage(it->connectId.ConnectionID,message);
+            if(!isBroadcastTarget_(*it))
+            {
+                continue;
+            }
+
+            vUserInfo.push_back(*it);
         }
     }
+
+    sendConnectionMessage_(vUserInfo,message,conflateKey,answer);
+}
+
+bool UserManager::isBroadcastTarget_(const UserInfo& userInfo)
+{
+    return (userInfo.connectId.SessionID != 0) || (!gateways_.contains(userInfo.connectId.ConnectionID));
+}
+
+void UserManager::sendConnectionMessage_(const QVector<UserInfo>& vUserInfo, const QJsonObject& message, const QString& conflateKey, const AnswerValue* answer)
+{
+    //句柄形式只在有接收者请求了句柄时生成一次;非组件变化或组件没有句柄时照常发送 cid 形式
+    QJsonObject handleMessage;
+    if (answer && answer->hasHandle())
+    {
+        foreach (const auto& userInfo, vUserInfo)
+        {
+            if (userInfo.componentHandle)
+            {
+                handleMessage = answer->handleMessage();
+                break;
+            }
+        }
+    }
+
+    auto selectMessage = [&](const UserInfo& userInfo) -> const QJsonObject&
+    {
+        return (userInfo.componentHandle && (!handleMessage.isEmpty())) ? handleMessage : message;
+    };
+
+    //独立连接共享同一份编码,网关会话的消息各自带上 sid
+    QVector<size_t> vShared;
+    QVector<size_t> vHandleShared;
+    vShared.reserve(vUserInfo.size());
+    foreach (const auto& userInfo, vUserInfo)
+    {
+        const auto& connection = userInfo.connectId;
+        const auto& connectionMessage = selectMessage(userInfo);
+        if (connection.SessionID == 0)
+        {
+            ((&connectionMessage == &message) ? vShared : vHandleShared).push_back(connection.ConnectionID);
+            continue;
+        }
+
+        gActionSimulationServer.sendNetMessage(connection.ConnectionID,
+                                               addSessionID(connectionMessage,connection.SessionID),
+                                               conflateKey.isEmpty() ? conflateKey : QStringLiteral("%1#%2").arg(conflateKey).arg(connection.SessionID));
+    }
+
+    gActionSimulationServer.sendNetMessage(vShared,message,conflateKey);
+    gActionSimulationServer.sendNetMessage(vHandleShared,handleMessage,conflateKey);
 }
 
 void UserManager::clear()
 {
     lock_guard<shared_mutex> lg(lockUser_);
     userInfo_.clear();
+    gateways_.clear();
 }
 
 bool UserManager::existUser(User userID)
@@ -26,14 +26,20 @@ SOFTWARE.
 ******************************************************************************/
 
 #include "commonstruct.h"
+#include "tokenbucket.h"
+#include "corecomponent.h"
 #include <QVector>
+#include <QJsonObject>
 #include <QHash>
+#include <QSet>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/identity.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <shared_mutex>
+#include <mutex>
+#include <array>
 #include <boost/bimap.hpp>
 #include <boost/bimap/multiset_of.hpp>
 
@@ -46,6 +52,7 @@ struct UserInfo
     Jimmy::Connection connectId;
     Jimmy::User userId;
     size_t role;
+    bool componentHandle;                       //组件变化以句柄代替 cid 发送
 
     UserInfo(Jimmy::Connection connId)
         :UserInfo(connId,Jimmy::User(),0)
@@ -56,10 +63,11 @@ struct UserInfo
         :connectId(connId)
         , userId(uId)
         , role(uRole)
+        , componentHandle(false)
     {}
 
-    bool operator<(const UserInfo& e)const{ return connectId.ConnectionID < e.connectId.ConnectionID; }
-    bool operator<=(const UserInfo& e)const{ return connectId.ConnectionID <= e.connectId.ConnectionID; }
+    bool operator<(const UserInfo& e)const{ return connectId < e.connectId; }
+    bool operator<=(const UserInfo& e)const{ return connectId <= e.connectId; }
 };
 
 struct UpdateUserInfo
@@ -99,6 +107,23 @@ public:
 
     void disconnect(size_t connection);
 
+    //网关连接上的会话在首次收到其消息时注册,与独立连接一样以访客身份开始
+    Jimmy::User registerSession(Jimmy::Connection connection);
+    void closeSession(Jimmy::Connection connection);
+
+    //网关连接本身不接收广播,其会话各自接收
+    void setGateway(size_t connection);
+    bool isGateway(size_t connection);
+    QVector<size_t> getSessions(size_t connection);
+
+    //load 时请求了句柄的连接(或会话),登录后仍然保留
+    void setComponentHandle(Jimmy::Connection connection);
+
+    //按用户限制接收速率,在 io 线程组包完成后调用,返回 false 时丢弃该消息
+    //单用户项目所有连接同属一个用户,网关连接代理多个用户,二者均只受连接级限制
+    bool acquireIngress(size_t connection);
+    size_t getThrottledMessages(Jimmy::User userID);
+
     void login(Jimmy::Connection connection,Jimmy::User userID,size_t role = Jimmy::UserRole::Normal);
 
     bool existUser(Jimmy::User userID);
@@ -107,17 +132,26 @@ public:
 
     QVector<UserInfo> getConnectIdbyUser(Jimmy::User userID);
 
-    void answerMessage(Jimmy::Connection connection, const QString& message);
-    void sendMessage(bool admin_Only,const QString& message);
-    void sendMessage(bool admin_Only,Jimmy::Connection excludeConnection, const QString& message);
-    void sendUserMessage(Jimmy::User userid,bool admin_Only,const QString& message);
-    void sendUserMessage(Jimmy::User userid,bool admin_Only,Jimmy::Connection excludeConnection,const QString& message);
-    void sendRoleMessage(size_t role,const QString& message);
-    void sendRoleMessage(size_t role,Jimmy::Connection excludeConnection, const QString& message);
+    void answerMessage(Jimmy::Connection connection, const QJsonObject& message);
+    //组件值按连接是否请求了句柄选择发送形式
+    void answerMessage(const UserInfo& userInfo, const Jimmy::AnswerValue& message);
+    //answer 带句柄时,请求了句柄的连接改发句柄形式
+    void sendMessage(bool admin_Only,const QJsonObject& message,const QString& conflateKey = QString(),const Jimmy::AnswerValue* answer = nullptr);
+    void sendMessage(bool admin_Only,Jimmy::Connection excludeConnection, const QJsonObject& message,const QString& conflateKey = QString(),const Jimmy::AnswerValue* answer = nullptr);
+    void sendUserMessage(Jimmy::User userid,bool admin_Only,const QJsonObject& message,const QString& conflateKey = QString());
+    void sendUserMessage(Jimmy::User userid,bool admin_Only,Jimmy::Connection excludeConnection,const QJsonObject& message,const QString& conflateKey = QString());
+    void sendUserMessage(Jimmy::User userid,bool admin_Only,const Jimmy::AnswerValue& message,const QString& conflateKey);
+    void sendUserMessage(Jimmy::User userid,bool admin_Only,Jimmy::Connection excludeConnection,const Jimmy::AnswerValue& message,const QString& conflateKey);
+    void sendRoleMessage(size_t role,const QJsonObject& message);
+    void sendRoleMessage(size_t role,Jimmy::Connection excludeConnection, const QJsonObject& message);
     void clear();
 private:
-    void sendUserMessage_(Jimmy::User userid,bool admin_Only, const QString& message);
-    void sendUserMessage_(Jimmy::User userid,bool admin_Only,Jimmy::Connection excludeConnection, const QString& message);
+    void sendUserMessage_(Jimmy::User userid,bool admin_Only, const QJsonObject& message,const QString& conflateKey,const Jimmy::AnswerValue* answer = nullptr);
+    void sendUserMessage_(Jimmy::User userid,bool admin_Only,Jimmy::Connection excludeConnection, const QJsonObject& message,const QString& conflateKey,const Jimmy::AnswerValue* answer = nullptr);
+
+    bool isBroadcastTarget_(const UserInfo& userInfo);
+    void sendConnectionMessage_(const QVector<UserInfo>& vUserInfo, const QJsonObject& message, const QString& conflateKey, const Jimmy::AnswerValue* answer);
+    void removeUsers_(const QVector<Jimmy::User>& vUserID);
 private:
     QVector<UserInfo> getConnectIdbyUsers_(const QVector<Jimmy::User>& vUserID);
 
@@ -125,5 +159,28 @@ private:
 private:
     std::shared_mutex lockUser_;
     RegisteredUserInfo userInfo_;
+    QSet<size_t> gateways_;
+
+    struct IngressLimit
+    {
+        Jimmy::TokenBucket bucket;
+        size_t throttledMessages{0};
+    };
+
+    //限流状态按用户号分片,io 线程上不同用户的消息只在各自分片上加锁
+    //每片独占缓存行,相邻分片的锁不会伪共享
+    struct alignas(64) IngressShard
+    {
+        QHash<Jimmy::User, IngressLimit> limits;
+        std::mutex lock;
+    };
+
+    static const size_t IngressShardCount = 64;
+
+    size_t userIngressRate_;
+    size_t userIngressBurst_;
+    std::array<IngressShard, IngressShardCount> ingressShards_;
+
+    IngressShard& getIngressShard_(Jimmy::User userID) { return ingressShards_[userID.userID % IngressShardCount]; }
 };
 